@@ -5,10 +5,41 @@
 #include ".\itkInitializationFilter.h"
 #include ".\itkManageTransformsFilter.h"
 #include ".\itkValidationFilter.h"
+#include ".\itkSurfaceValidationFilter.h"
+#include ".\itkSharedImageCache.h"
+#include ".\itkBatchScheduler.h"
 
 // rescale images
 #include "itkRescaleIntensityImageFilter.h"
 
+// monitoring
+#include "itkMemoryProbesCollectorBase.h"
+#include "itkTimeProbe.h"
+#include "itkCommand.h"
+
+// asynchronous validation
+#include <algorithm>
+#include <future>
+#include <mutex>
+#include <sstream>
+
+// batch mode
+#include "itkImageDuplicator.h"
+#include "itkMultiThreader.h"
+#include <fstream>
+
+// peak memory
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
 #include "itkPluginUtilities.h"
 #include "Multi-LevelRegistrationCLP.h"
 
@@ -21,12 +52,164 @@
 namespace
 {
 
+// compute validation measures for one transform and return the printed results
+// (runs on a snapshot of the transform so the next level can register in the meantime)
 template <typename TPixel>
-int DoIt( int argc, char * argv[], TPixel )
+std::string ValidateTransform( typename itk::ManageTransformsFilter<TPixel>::Pointer transforms,
+	typename itk::Image< TPixel, 3 >::Pointer fixedImage, itk::Image< unsigned char, 3 >::Pointer fixedImageMask,
+	typename itk::Image< TPixel, 3 >::Pointer movingImage, itk::Image< unsigned char, 3 >::Pointer movingImageMask,
+	itk::Transform< double, 3, 3 >::ConstPointer transform, std::string title )
+{
+	typedef itk::Image< TPixel, 3 >				ImageType;
+	typedef itk::Image< unsigned char, 3 >		MaskImageType;
+
+	std::ostringstream output;
+	output << "\n*********************************************" << std::endl;
+	output << "  " << title << std::endl;
+	output << "*********************************************" << std::endl;
+
+	typename itk::ValidationFilter<TPixel>::Pointer validationFilter = itk::ValidationFilter<TPixel>::New();
+	validationFilter->SetOutputStream(&output);
+	try
+	{
+		typename ImageType::Pointer resampledImage;
+		MaskImageType::Pointer resampledLabelMap;
+		transforms->ResampleImageAndLabelMap(movingImage, movingImageMask, transform, resampledImage, resampledLabelMap);
+		validationFilter->SetImage1(fixedImage);
+		validationFilter->SetLabelMap1(fixedImageMask);
+		validationFilter->SetImage2(resampledImage);
+		validationFilter->SetLabelMap2(resampledLabelMap);
+		validationFilter->LabelOverlapMeasuresOn();
+		validationFilter->Update();
+	}
+	catch (itk::ExceptionObject & err)
+	{
+		output << "Exception Object Caught!" << std::endl;
+		output << err << std::endl;
+		output << std::endl;
+	}
+
+	return output.str();
+}
+
+// estimate validation measures for one transform from the label surfaces (no resampling)
+std::string ValidateSurfaces( itk::SurfaceValidationFilter< itk::Image< unsigned char, 3 > >::Pointer surfaceValidation,
+	itk::Transform< double, 3, 3 >::ConstPointer transform, std::string title )
+{
+	std::ostringstream output;
+	output << "\n*********************************************" << std::endl;
+	output << "  " << title << " (SURFACES)" << std::endl;
+	output << "*********************************************" << std::endl;
+
+	surfaceValidation->SetOutputStream(&output);
+	surfaceValidation->SetTransform(transform);
+	try
+	{
+		surfaceValidation->Update();
+	}
+	catch (itk::ExceptionObject & err)
+	{
+		output << "Exception Object Caught!" << std::endl;
+		output << err << std::endl;
+		output << std::endl;
+	}
+
+	return output.str();
+}
+
+// report the time from startup to the first optimizer iteration (client data is the running clock)
+// (parallel ROIs observe the same clock from their own threads, so the check and stop are locked)
+void ReportFirstIteration( itk::Object *, const itk::EventObject &, void * clientData )
+{
+	static std::mutex mutex;
+	std::lock_guard< std::mutex > lock(mutex);
+	itk::TimeProbe * clock = static_cast< itk::TimeProbe * >( clientData );
+	if (clock->GetNumberOfStops() == 0)
+	{
+		clock->Stop();
+		std::cout << "Time to first iteration: " << clock->GetTotal() << " s" << std::endl;
+	}
+}
+
+// peak memory of the process so far in MB (high-water mark of the resident set, so it never decreases)
+double PeakMemoryUsage()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return 0.0;
+	}
+	return counters.PeakWorkingSetSize / (1024.0*1024.0);
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0.0;
+	}
+#ifdef __APPLE__
+	return usage.ru_maxrss / (1024.0*1024.0);	// bytes
+#else
+	return usage.ru_maxrss / 1024.0;	// kilobytes
+#endif
+#endif
+}
+
+// one registration of a batch manifest
+struct BatchJobType
+{
+	std::string fixedImageFilename;
+	std::string movingImageFilename;
+	std::string finalTransform;
+	std::string fixedImageMaskFilename;
+	std::string movingImageMaskFilename;
+	std::string debugDirectory;
+};
+
+// filename of the composite transform of one of several ROIs at the last level: <name>_ROI<roi><extension>
+std::string ROITransformFilename( const std::string & filename, int roi )
+{
+	std::string name = filename;
+	std::string extension;
+	const std::string::size_type dot = name.find_last_of('.');
+	if (dot != std::string::npos && (name.find_last_of("/\\") == std::string::npos || dot > name.find_last_of("/\\")))
+	{
+		extension = name.substr(dot);
+		name.erase(dot);
+	}
+	return name + "_ROI" + std::to_string(roi) + extension;
+}
+
+// read the fixed image, from the images shared by a batch if given
+template <typename ImageType>
+typename ImageType::Pointer ReadInFixedImage( const std::string & filename, itk::ImageIOBase * io, itk::SharedImageCache * sharedImages )
+{
+	if (sharedImages)
+	{
+		return sharedImages->Get< ImageType >(filename, io);
+	}
+	return ReadInImage< ImageType >(filename.c_str(), io);
+}
+
+template <typename TPixel>
+int DoIt( int argc, char * argv[], itk::ImageIOBase * fixedImageIO, itk::TimeProbe * startupClock,
+	const BatchJobType * job, itk::SharedImageCache * sharedImages, TPixel )
 {
 	// parse through inputs 
 	PARSE_ARGS;
 
+	// a batch job replaces the images and outputs of the command line
+	if (job)
+	{
+		fixedImageFilename = job->fixedImageFilename;
+		movingImageFilename = job->movingImageFilename;
+		finalTransform = job->finalTransform;
+		fixedImageMaskFilename = job->fixedImageMaskFilename;
+		movingImageMaskFilename = job->movingImageMaskFilename;
+		debugDirectory = job->debugDirectory;
+		comparisonImageFilename = "";
+	}
+
 	// print out start
 	std::cout << "-----------------------------------------------------------------------------" << std::endl;
 	std::cout << "                         MULTI-LEVEL REGISTRATION ";
@@ -56,7 +239,40 @@ int DoIt( int argc, char * argv[], TPixel )
 
 	// fixed and moving images
 	ImageType::Pointer fixedImage = ImageType::New();
-	ImageType::Pointer movingImage = ReadInImage< ImageType >(movingImageFilename.c_str());
+	ImageType::Pointer movingImage;
+
+	// a moving image preprocessed with the same settings is read from the cache instead
+	// (nothing is cached when no preprocessing step is enabled)
+	std::string preprocessedFilename;
+	const bool preprocessingEnabled = biasCorrection || upperThreshold > 0 || lowerThreshold > 0 || sigma > 0;
+	if (!preprocessingCache.empty() && preprocessingEnabled)
+	{
+		try
+		{
+			const std::string movingImageHash = HashFile(movingImageFilename.c_str());
+			if (movingImageHash.empty())
+			{
+				std::cout << "The moving image data file could not be located, the preprocessing cache is not used." << std::endl;
+			}
+			else
+			{
+				preprocessedFilename = preprocessingCache + "/Preprocessed_" + PreprocessingCacheKey< ImageType >(movingImageHash,
+					biasCorrection, biasCorrectionShrinkFactor, upperThreshold, lowerThreshold, sigma, !discreteGaussian) + ".bin";
+				movingImage = ReadInCachedImage< ImageType >(preprocessedFilename.c_str());
+			}
+		}
+		catch (itk::ExceptionObject & err)
+		{
+			std::cerr << "Exception Object Caught!" << std::endl;
+			std::cerr << err << std::endl;
+			std::cerr << std::endl;
+		}
+	}
+	const bool movingImagePreprocessed = movingImage.IsNotNull();
+	if (!movingImagePreprocessed)
+	{
+		movingImage = ReadInImage< ImageType >(movingImageFilename.c_str());
+	}
 	if (validation)
 	{
 		movingImageMask = ReadInImage< MaskImageType >(movingImageMaskFilename.c_str());
@@ -67,11 +283,19 @@ int DoIt( int argc, char * argv[], TPixel )
 	{
 		// apply transform to fixed image
 		TransformType::Pointer initialFixedTransform = ReadInTransform< TransformType >(fixedImageInitialTransform.c_str());
-		ImageType::Pointer fixedImageTemp = ReadInImage< ImageType >(fixedImageFilename.c_str());
+		ImageType::Pointer fixedImageTemp = ReadInFixedImage< ImageType >(fixedImageFilename, fixedImageIO, sharedImages);
 		try
 		{
+			// only the geometry of the reference image is needed
 			std::cout << "Applying initial transform to fixed image." << std::endl;
-			transforms->SetFixedImage(ReadInImage< ImageType >(referenceImage.c_str()));
+			if (referenceImage == fixedImageFilename)
+			{
+				transforms->SetFixedImage(fixedImageTemp);
+			}
+			else
+			{
+				transforms->SetFixedImage(ReadInImageInformation< ImageType >(referenceImage.c_str()));
+			}
 			fixedImage = transforms->ResampleImage< ImageType >(fixedImageTemp, initialFixedTransform);
 		}
 		catch (itk::ExceptionObject & err)
@@ -93,7 +317,7 @@ int DoIt( int argc, char * argv[], TPixel )
 	}
 	else
 	{
-		fixedImage = ReadInImage< ImageType >(fixedImageFilename.c_str());
+		fixedImage = ReadInFixedImage< ImageType >(fixedImageFilename, fixedImageIO, sharedImages);
 		std::cout << "Fixed image read in." << std::endl;
 		std::cout << "Moving image read in." << std::endl;
 
@@ -108,26 +332,62 @@ int DoIt( int argc, char * argv[], TPixel )
 	std::cout << "              PREPROCESSING                  " << std::endl;
 	std::cout << "*********************************************\n" << std::endl;
 
-	if (upperThreshold > 0)
+	if (movingImagePreprocessed)
 	{
-		movingImage = UpperThresholdImage< ImageType >(movingImage, upperThreshold);
+		std::cout << "Preprocessed moving image read from " << preprocessedFilename << std::endl;
 	}
-	if (lowerThreshold > 0)
+	else
 	{
-		movingImage = LowerThresholdImage< ImageType >(movingImage, lowerThreshold);
+		// bias field correction of MR images
+		if (biasCorrection)
+		{
+			movingImage = BiasCorrectImage< ImageType >(movingImage, biasCorrectionShrinkFactor, biasCorrectionCache);
+		}
+
+		// thresholds and smoothing are applied in the moving image buffer
+		if (upperThreshold > 0 || lowerThreshold > 0 || sigma > 0)
+		{
+			movingImage = PreprocessImage< ImageType >(movingImage, upperThreshold, lowerThreshold, sigma, !discreteGaussian);
+		}
+
+		// store for later runs (before normalization, which depends on the fixed image)
+		if (!preprocessedFilename.empty() && WriteOutCachedImage< ImageType >(preprocessedFilename.c_str(), movingImage) == EXIT_SUCCESS)
+		{
+			std::cout << "Preprocessed moving image written to " << preprocessedFilename << std::endl;
+		}
+	}
+
+	// intensity normalization from random samples (applied in place)
+	if (intensityNormalization == "percentile")
+	{
+		// a fixed image shared with other jobs is normalized on a copy
+		if (sharedImages && fixedImageInitialTransform.empty())
+		{
+			typedef itk::ImageDuplicator< ImageType > DuplicatorType;
+			DuplicatorType::Pointer duplicator = DuplicatorType::New();
+			duplicator->SetInputImage(fixedImage);
+			duplicator->Update();
+			fixedImage = duplicator->GetModifiableOutput();
+		}
+		fixedImage = NormalizeImage< ImageType >(fixedImage, intensitySamples, 1.0, 99.0);
+		movingImage = NormalizeImage< ImageType >(movingImage, intensitySamples, 1.0, 99.0);
 	}
-	if (sigma > 0)
+	else if (intensityNormalization == "histogramMatching")
 	{
-		movingImage = SmoothImage< ImageType >(movingImage, sigma);
+		movingImage = MatchHistogram< ImageType >(movingImage, fixedImage, intensitySamples, numberOfMatchPoints, 1.0, 99.0);
 	}
 
 	// write out preprocessed images if debugging
 	if (!debugDirectory.empty() && debugImages)
 	{
 		std::string movingFilename = debugDirectory + "\\PreprocessedMovingImage.nrrd";
-		WriteOutImage< ImageType, ImageType >(movingFilename.c_str(), transforms->GetTransformedImage());
+		WriteOutCompressedImage< ImageType, ImageType >(movingFilename.c_str(), transforms->GetTransformedImage());
 	}
 
+	// peak memory of reading and preprocessing
+	const double preprocessingPeakMemory = PeakMemoryUsage();
+	std::cout << "Peak memory after preprocessing: " << preprocessingPeakMemory << " MB" << std::endl;
+
 	// initialization
 	std::cout << "\n*********************************************" << std::endl;
 	std::cout << "              INITIALIZATION                 " << std::endl;
@@ -185,31 +445,62 @@ int DoIt( int argc, char * argv[], TPixel )
 		WriteOutTransform< TransformType >(transformFilename.c_str(), initialTransform);
 	}
 
-	// validation at initialTransform
-	itk::ValidationFilter<PixelType>::Pointer validationFilter = itk::ValidationFilter<PixelType>::New();
-	if (validation)
+	// the validation and ROI threads share these images from here on; detached from the filters
+	// that produced them, their pipelines are never updated from several threads at once
+	fixedImage->DisconnectPipeline();
+	movingImage->DisconnectPipeline();
+	fixedImageMask->DisconnectPipeline();
+	movingImageMask->DisconnectPipeline();
+
+	// fast per-level validation: label surfaces and distance maps are extracted once
+	typedef itk::SurfaceValidationFilter< MaskImageType >	SurfaceValidationType;
+	SurfaceValidationType::Pointer surfaceValidation;
+	if (validation && fastValidation)
 	{
-		validationFilter->SetImage1(fixedImage);
-		validationFilter->SetLabelMap1(fixedImageMask);
-		validationFilter->SetImage2(transforms->ResampleImage< ImageType >(movingImage, initialTransform));
-		transforms->NearestNeighborInterpolateOn();
-		validationFilter->SetLabelMap2(transforms->ResampleImage< MaskImageType >(movingImageMask, initialTransform));
-		transforms->NearestNeighborInterpolateOff();
-		validationFilter->LabelOverlapMeasuresOn();
+		surfaceValidation = SurfaceValidationType::New();
+		surfaceValidation->SetFixedLabelMap(fixedImageMask);
+		surfaceValidation->SetMovingLabelMap(movingImageMask);
 		try
 		{
-			validationFilter->Update();
+			surfaceValidation->Initialize();
 		}
 		catch (itk::ExceptionObject & err)
 		{
 			std::cerr << "Exception Object Caught!" << std::endl;
 			std::cerr << err << std::endl;
 			std::cerr << std::endl;
+			std::cout << "Validation falls back to resampling." << std::endl;
+			surfaceValidation = ITK_NULLPTR;
+		}
+	}
+
+	// validation at initialTransform (printed once the first level has registered)
+	std::future< std::string > pendingValidation;
+	if (validation)
+	{
+		TransformType::Pointer initialSnapshot = initialTransform->Clone();
+		if (surfaceValidation)
+		{
+			pendingValidation = std::async(std::launch::async, itk::BatchScheduler::WithThreadLog(ValidateSurfaces), surfaceValidation,
+				itk::Transform< double, 3, 3 >::ConstPointer(initialSnapshot.GetPointer()), std::string("VALIDATION: INITIAL TRANSFORM"));
+		}
+		else
+		{
+			pendingValidation = std::async(std::launch::async, itk::BatchScheduler::WithThreadLog(ValidateTransform< PixelType >), transforms,
+				fixedImage, fixedImageMask, movingImage, movingImageMask,
+				itk::Transform< double, 3, 3 >::ConstPointer(initialSnapshot.GetPointer()), std::string("VALIDATION: INITIAL TRANSFORM"));
 		}
 	}
 
 	// determine the number of ROIs and creating iterators
-	int numberOfROIs = ROI.size();
+	// (the last numberOfParallelROIs ROIs are all used at the last level)
+	const int numberOfParallelROIs = std::max(1, parallelROIs);
+	if (static_cast< int >(ROI.size()) < numberOfParallelROIs)
+	{
+		std::cout << "Fewer ROIs than parallel ROIs specified." << std::endl;
+		return EXIT_FAILURE;
+	}
+	int numberOfROIs = ROI.size() - (numberOfParallelROIs - 1);
 	bool ROI1 = false;
 
 	std::vector< std::vector< float> >::iterator it = ROI.begin();
@@ -227,17 +518,221 @@ int DoIt( int argc, char * argv[], TPixel )
 		return EXIT_FAILURE;
 	}
 
+	// change in memory over the registration of each level (start/stop difference, not the peak)
+	itk::MemoryProbesCollectorBase memoryProbes;
+
+	// debug images and transforms are written on a separate thread
+	itk::BackgroundWriter::Pointer backgroundWriter = itk::BackgroundWriter::New();
+
+	// optimizer settings, observers and debug output of a registration at a level
+	auto configureRegistration = [&](itk::RegistrationFramework<PixelType> * registration, int level, const std::string & debugName)
+	{
+		registration->SetNumberOfIterations(numberOfIterations);
+		registration->SetRelaxationFactor(relaxationFactor);
+		registration->SetMinimumStepLength(minimumStepLength);
+		registration->SetGradientMagnitudeTolerance(gradientMagnitudeTolerance);
+
+		if (level != 1)
+		{
+			registration->SetMaximumStepLength(maximumStepLength / (parameterRelaxation*(level - 1)));
+			registration->SetRotationScale(rotationScale / (parameterRelaxation*(level - 1)));
+			registration->SetTranslationScale(translationScale / (parameterRelaxation*(level - 1)));
+			registration->SetScalingScale(scalingScale / (parameterRelaxation*(level - 1)));
+		}
+		else
+		{
+			registration->SetMaximumStepLength(maximumStepLength);
+			registration->SetRotationScale(rotationScale);
+			registration->SetTranslationScale(translationScale);
+			registration->SetScalingScale(scalingScale);
+		}
+
+		// observe process
+		if (observe) { registration->ObserveOn(); }
+		if (debugTransforms)
+		{
+			registration->DebugOn();
+			std::string directory = debugDirectory + "\\" + debugName;
+			registration->SetDebugDirectory(directory);
+		}
+
+		// report time to the first iteration
+		itk::CStyleCommand::Pointer firstIteration = itk::CStyleCommand::New();
+		firstIteration->SetCallback(ReportFirstIteration);
+		firstIteration->SetClientData(startupClock);
+		registration->AddIterationObserver(firstIteration);
+	};
+
+	// several ROIs at the last level are registered side by side
+	bool parallelROIsRegistered = false;
+
 	for (int level = 1; level < numberOfLevels + 1; ++level)
 	{
 		std::cout << "\n*********************************************" << std::endl;
 		std::cout << "            REGISTRATION LEVEL " << level << "               " << std::endl;
 		std::cout << "*********************************************\n" << std::endl;
 
+		// register the remaining ROIs side by side, each from a snapshot of the previous levels
+		if (level == numberOfLevels && numberOfParallelROIs > 1)
+		{
+			typedef itk::ManageTransformsFilter<PixelType>		ManageTransformsType;
+			typedef itk::RegistrationFramework<PixelType>		RegistrationFrameworkType;
+
+			// apply transform from previous levels once for all ROIs
+			if (hardenTransform)
+			{
+				transforms->HardenTransformOn();
+			}
+			else
+			{
+				transforms->ResampleImageOn();
+			}
+			transforms->CropImageOff();
+			try
+			{
+				transforms->Update();
+			}
+			catch (itk::ExceptionObject & err)
+			{
+				std::cerr << "Exception Object Caught!" << std::endl;
+				std::cerr << err << std::endl;
+				std::cerr << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			// the snapshots of all ROIs share the transformed image (see above)
+			transforms->GetTransformedImage()->DisconnectPipeline();
+
+			// the metric threads are divided between the registrations
+			const unsigned int threadsPerROI = std::max(1u, itk::MultiThreader::GetGlobalDefaultNumberOfThreads() / numberOfParallelROIs);
+
+			std::string levelName = "Level " + std::to_string(level);
+			memoryProbes.Start(levelName.c_str());
+			std::vector< ManageTransformsType::Pointer > roiTransforms;
+			std::vector< RegistrationFrameworkType::Pointer > roiRegistrations;
+			std::vector< std::future< void > > roiFutures;
+			for (int roi = 1; roi < numberOfParallelROIs + 1; ++roi, ++it)
+			{
+				std::cout << "ROI " << roi << ": ";
+				for (std::vector<float>::iterator jt = (*it).begin(); jt != (*it).end(); jt++)
+				{
+					std::cout << *jt << ", ";
+				}
+				std::cout << std::endl;
+
+				// crop region of the ROI (the moving image is shared, not resampled again)
+				ManageTransformsType::Pointer roiTransform = transforms->Snapshot();
+				roiTransform->SetROI(*it);
+				roiTransform->CropImageOn();
+				try
+				{
+					roiTransform->Update();
+				}
+				catch (itk::ExceptionObject & err)
+				{
+					std::cerr << "Exception Object Caught!" << std::endl;
+					std::cerr << err << std::endl;
+					std::cerr << std::endl;
+					return EXIT_FAILURE;
+				}
+
+				RegistrationFrameworkType::Pointer roiRegistration = RegistrationFrameworkType::New();
+				roiRegistration->SetFixedImage(fixedImage);
+				roiRegistration->SetFixedImageRegion(roiTransform->GetFixedCropRegion());
+				roiRegistration->SetMovingImage(roiTransform->GetTransformedImage());
+				roiRegistration->SetMovingImageROI(roiTransform->GetROIStartPoint(), roiTransform->GetROIEndPoint());
+				roiRegistration->SetNumberOfThreads(threadsPerROI);
+				configureRegistration(roiRegistration, level, "Level" + std::to_string(level) + "ROI" + std::to_string(roi));
+
+				roiTransforms.push_back(roiTransform);
+				roiRegistrations.push_back(roiRegistration);
+				roiFutures.push_back(std::async(std::launch::async, itk::BatchScheduler::WithThreadLog([roiRegistration]() { roiRegistration->Update(); })));
+			}
+
+			// wait for all registrations
+			for (unsigned int i = 0; i < roiFutures.size(); ++i)
+			{
+				try
+				{
+					roiFutures[i].get();
+				}
+				catch (itk::ExceptionObject & err)
+				{
+					std::cerr << "Exception Object Caught!" << std::endl;
+					std::cerr << err << std::endl;
+					std::cerr << std::endl;
+				}
+			}
+			memoryProbes.Stop(levelName.c_str());
+
+			// print validation of the previous level, which ran during these registrations
+			if (pendingValidation.valid())
+			{
+				std::cout << pendingValidation.get();
+			}
+
+			// results, transforms and validation of each ROI in order
+			std::vector< std::future< std::string > > roiValidations;
+			for (unsigned int i = 0; i < roiRegistrations.size(); ++i)
+			{
+				const int roi = i + 1;
+				std::cout << "\nROI " << roi << std::endl;
+				roiRegistrations[i]->Print();
+
+				roiTransforms[i]->AddTransform(roiRegistrations[i]->GetFinalTransform());
+				std::string roiTransformFilename = ROITransformFilename(finalTransform, roi);
+				WriteOutTransformInBackground< ManageTransformsType::CompositeTransformType >(backgroundWriter, roiTransformFilename.c_str(), roiTransforms[i]->GetCompositeTransform());
+
+				if (!debugDirectory.empty() && debugTransforms)
+				{
+					std::string transformFilename = debugDirectory + "\\Level" + std::to_string(level) + "ROI" + std::to_string(roi) + "Transform.tfm";
+					WriteOutTransformInBackground< ManageTransformsType::CompositeTransformType >(backgroundWriter, transformFilename.c_str(), roiTransforms[i]->GetCompositeTransform());
+				}
+
+				if (!debugDirectory.empty() && debugImages)
+				{
+					std::string movingFilename = debugDirectory + "\\Level" + std::to_string(level) + "ROI" + std::to_string(roi) + "OuputMovingImage.nrrd";
+					WriteOutImageInBackground< ImageType, ImageType >(backgroundWriter, movingFilename.c_str(), roiTransforms[i]->ResampleImage< ImageType >(movingImage, roiTransforms[i]->GetCompositeTransform()));
+				}
+
+				// the composite of each snapshot is not changed anymore and can be validated directly
+				// (each ROI gets its own surface validation filter, since Update() is not reentrant)
+				if (validation && surfaceValidation)
+				{
+					roiValidations.push_back(std::async(std::launch::async, itk::BatchScheduler::WithThreadLog(ValidateSurfaces), surfaceValidation->CreateSharedCopy(),
+						itk::Transform< double, 3, 3 >::ConstPointer(roiTransforms[i]->GetCompositeTransform()),
+						"VALIDATION: LEVEL " + std::to_string(level) + " ROI " + std::to_string(roi)));
+				}
+				else if (validation)
+				{
+					roiValidations.push_back(std::async(std::launch::async, itk::BatchScheduler::WithThreadLog(ValidateTransform< PixelType >), roiTransforms[i],
+						fixedImage, fixedImageMask, movingImage, movingImageMask,
+						itk::Transform< double, 3, 3 >::ConstPointer(roiTransforms[i]->GetCompositeTransform()),
+						"VALIDATION: LEVEL " + std::to_string(level) + " ROI " + std::to_string(roi)));
+				}
+			}
+			for (unsigned int i = 0; i < roiValidations.size(); ++i)
+			{
+				std::cout << roiValidations[i].get();
+			}
+
+			parallelROIsRegistered = true;
+			break;
+		}
+
 		// prepare the Registration framework
 		itk::RegistrationFramework<PixelType>::Pointer registration = itk::RegistrationFramework<PixelType>::New();
 
 		// apply transform from previous level 
-		transforms->ResampleImageOn();
+		if (hardenTransform)
+		{
+			// rigid transforms are written into the image header instead of resampling
+			transforms->HardenTransformOn();
+		}
+		else
+		{
+			transforms->ResampleImageOn();
+		}
 
 		// insert appropriate ROI into transforms class and crop image
 		if (level == 1 && ROI1) // if it is level 1 and ROI is to be used in Level 1
@@ -268,15 +763,17 @@ int DoIt( int argc, char * argv[], TPixel )
 				std::cerr << std::endl;
 				return EXIT_FAILURE;
 			}
-			registration->SetFixedImage(transforms->GetFixedCroppedImage());
-			registration->SetMovingImage(transforms->GetMovingCroppedImage());
+			registration->SetFixedImage(fixedImage);
+			registration->SetFixedImageRegion(transforms->GetFixedCropRegion());
+			registration->SetMovingImage(transforms->GetTransformedImage());
+			registration->SetMovingImageROI(transforms->GetROIStartPoint(), transforms->GetROIEndPoint());
 
 			if (!debugDirectory.empty() && debugImages)
 			{
 				std::string fixedFilename = debugDirectory + "\\Level" + std::to_string(level) + "InputFixedImage.nrrd";
-				WriteOutImage< ImageType, ImageType >(fixedFilename.c_str(), transforms->GetTransformedImage());
+				WriteOutImageInBackground< ImageType, ImageType >(backgroundWriter, fixedFilename.c_str(), transforms->GetTransformedImage());
 				std::string movingFilename = debugDirectory + "\\Level" + std::to_string(level) + "InputMovingImage.nrrd";
-				WriteOutImage< ImageType, ImageType >(movingFilename.c_str(), transforms->GetTransformedImage());
+				WriteOutImageInBackground< ImageType, ImageType >(backgroundWriter, movingFilename.c_str(), transforms->GetTransformedImage());
 			}
 		}
 		else if (level != 1) // if it is not level 1
@@ -305,15 +802,17 @@ int DoIt( int argc, char * argv[], TPixel )
 				std::cerr << std::endl;
 				return EXIT_FAILURE;
 			}
-			registration->SetFixedImage(transforms->GetFixedCroppedImage());
-			registration->SetMovingImage(transforms->GetMovingCroppedImage());
+			registration->SetFixedImage(fixedImage);
+			registration->SetFixedImageRegion(transforms->GetFixedCropRegion());
+			registration->SetMovingImage(transforms->GetTransformedImage());
+			registration->SetMovingImageROI(transforms->GetROIStartPoint(), transforms->GetROIEndPoint());
 
 			if (!debugDirectory.empty() && debugImages)
 			{
 				std::string fixedFilename = debugDirectory + "\\Level" + std::to_string(level) + "InputFixedImage.nrrd";
-				WriteOutImage< ImageType, ImageType >(fixedFilename.c_str(), transforms->GetTransformedImage());
+				WriteOutImageInBackground< ImageType, ImageType >(backgroundWriter, fixedFilename.c_str(), transforms->GetTransformedImage());
 				std::string movingFilename = debugDirectory + "\\Level" + std::to_string(level) + "InputMovingImage.nrrd";
-				WriteOutImage< ImageType, ImageType >(movingFilename.c_str(), transforms->GetTransformedImage());
+				WriteOutImageInBackground< ImageType, ImageType >(backgroundWriter, movingFilename.c_str(), transforms->GetTransformedImage());
 			}
 		}
 		else // ROI is not applied at level
@@ -338,41 +837,16 @@ int DoIt( int argc, char * argv[], TPixel )
 			{
 				std::cout << "Fixed image not changed at level " << level << std::endl;
 				std::string movingFilename = debugDirectory + "\\Level" + std::to_string(level) + "InputMovingImage.nrrd";
-				WriteOutImage< ImageType, ImageType >(movingFilename.c_str(), transforms->GetTransformedImage());
+				WriteOutImageInBackground< ImageType, ImageType >(backgroundWriter, movingFilename.c_str(), transforms->GetTransformedImage());
 			}
 		}
 
 		// insert parameters into registration
-		registration->SetNumberOfIterations(numberOfIterations);
-		registration->SetRelaxationFactor(relaxationFactor);
-		registration->SetMinimumStepLength(minimumStepLength);
-		registration->SetGradientMagnitudeTolerance(gradientMagnitudeTolerance);
-
-		if (level != 1)
-		{
-			registration->SetMaximumStepLength(maximumStepLength / (parameterRelaxation*(level - 1)));
-			registration->SetRotationScale(rotationScale / (parameterRelaxation*(level - 1)));
-			registration->SetTranslationScale(translationScale / (parameterRelaxation*(level - 1)));
-			registration->SetScalingScale(scalingScale / (parameterRelaxation*(level - 1)));
-		}
-		else
-		{
-			registration->SetMaximumStepLength(maximumStepLength);
-			registration->SetRotationScale(rotationScale);
-			registration->SetTranslationScale(translationScale);
-			registration->SetScalingScale(scalingScale);
-		}
-
-		// observe process
-		if (observe) { registration->ObserveOn(); }
-		if (debugTransforms)
-		{
-			registration->DebugOn();
-			std::string directory = debugDirectory + "\\Level" + std::to_string(level);
-			registration->SetDebugDirectory(directory);
-		}
+		configureRegistration(registration, level, "Level" + std::to_string(level));
 
 		// perform registration
+		std::string levelName = "Level " + std::to_string(level);
+		memoryProbes.Start(levelName.c_str());
 		try
 		{
 			registration->Update();
@@ -383,109 +857,359 @@ int DoIt( int argc, char * argv[], TPixel )
 			std::cerr << err << std::endl;
 			std::cerr << std::endl;
 		}
+		memoryProbes.Stop(levelName.c_str());
 
 		// print results
 		registration->Print();
 
+		// print validation of the previous level, which ran during this registration
+		if (pendingValidation.valid())
+		{
+			std::cout << pendingValidation.get();
+		}
+
 		// add transform to transforms class
 		transforms->AddTransform(registration->GetFinalTransform());
 
 		// write out composite transform
-		WriteOutTransform< itk::ManageTransformsFilter<PixelType>::CompositeTransformType >(finalTransform.c_str(), transforms->GetCompositeTransform());
+		WriteOutTransformInBackground< itk::ManageTransformsFilter<PixelType>::CompositeTransformType >(backgroundWriter, finalTransform.c_str(), transforms->GetCompositeTransform());
 
 		// write out transforms
 		if (!debugDirectory.empty() && debugTransforms)
 		{
 			std::string transformFilename = debugDirectory + "\\Level" + std::to_string(level) + "Transform.tfm";
-			WriteOutTransform< itk::ManageTransformsFilter<PixelType>::CompositeTransformType >(transformFilename.c_str(), transforms->GetCompositeTransform());
+			WriteOutTransformInBackground< itk::ManageTransformsFilter<PixelType>::CompositeTransformType >(backgroundWriter, transformFilename.c_str(), transforms->GetCompositeTransform());
 		}
 
 		// write out images
 		if (!debugDirectory.empty() && debugImages)
 		{
 			std::string movingFilename = debugDirectory + "\\Level" + std::to_string(level) + "OuputMovingImage.nrrd";
-			WriteOutImage< ImageType, ImageType >(movingFilename.c_str(), transforms->ResampleImage< ImageType >(movingImage, transforms->GetCompositeTransform()));
+			WriteOutImageInBackground< ImageType, ImageType >(backgroundWriter, movingFilename.c_str(), transforms->ResampleImage< ImageType >(movingImage, transforms->GetCompositeTransform()));
 		}
 
-		// obtain validation measures
+		// obtain validation measures on a snapshot while the next level registers
 		if (validation)
 		{
-			validationFilter->SetImage2(transforms->ResampleImage< ImageType >(movingImage, transforms->GetCompositeTransform()));
-			transforms->NearestNeighborInterpolateOn();
-			validationFilter->SetLabelMap2(transforms->ResampleImage< MaskImageType >(movingImageMask, transforms->GetCompositeTransform()));
-			transforms->NearestNeighborInterpolateOff();
-			validationFilter->LabelOverlapMeasuresOn();
-			try
+			itk::ManageTransformsFilter<PixelType>::CompositeTransformType::Pointer compositeSnapshot = transforms->GetCompositeTransform()->Clone();
+			if (surfaceValidation)
 			{
-				validationFilter->Update();
+				pendingValidation = std::async(std::launch::async, itk::BatchScheduler::WithThreadLog(ValidateSurfaces), surfaceValidation,
+					itk::Transform< double, 3, 3 >::ConstPointer(compositeSnapshot.GetPointer()), "VALIDATION: LEVEL " + std::to_string(level));
 			}
-			catch (itk::ExceptionObject & err)
+			else
 			{
-				std::cerr << "Exception Object Caught!" << std::endl;
-				std::cerr << err << std::endl;
-				std::cerr << std::endl;
+				pendingValidation = std::async(std::launch::async, itk::BatchScheduler::WithThreadLog(ValidateTransform< PixelType >), transforms,
+					fixedImage, fixedImageMask, movingImage, movingImageMask,
+					itk::Transform< double, 3, 3 >::ConstPointer(compositeSnapshot.GetPointer()), "VALIDATION: LEVEL " + std::to_string(level));
 			}
 		}
 	}
 
+	// print validation of the last level
+	if (pendingValidation.valid())
+	{
+		std::cout << pendingValidation.get();
+	}
+
+	// full resample for the final report when levels were validated from surfaces
+	// (parallel ROIs have no single final transform and were reported above)
+	if (surfaceValidation && !parallelROIsRegistered)
+	{
+		std::cout << ValidateTransform< PixelType >(transforms, fixedImage, fixedImageMask, movingImage, movingImageMask,
+			itk::Transform< double, 3, 3 >::ConstPointer(transforms->GetCompositeTransform()), "VALIDATION: FINAL TRANSFORM");
+	}
+
+	// write out comparison image of the fixed and the final registered moving image
+	// (not written for parallel ROIs, which have no single final transform)
+	if (!comparisonImageFilename.empty() && parallelROIsRegistered)
+	{
+		std::cout << "Comparison image not written for parallel ROIs" << std::endl;
+	}
+	else if (!comparisonImageFilename.empty())
+	{
+		itk::ValidationFilter<PixelType>::Pointer comparison = itk::ValidationFilter<PixelType>::New();
+		comparison->SetImage1(fixedImage);
+		comparison->SetImage2(movingImage);
+		comparison->SetTransform(transforms->GetCompositeTransform());
+		comparison->SetComparisonImageFilename(comparisonImageFilename);
+		if (comparisonMode == "difference")
+		{
+			comparison->SetComparisonMode(itk::ValidationFilter<PixelType>::AbsoluteDifference);
+		}
+		else if (comparisonMode == "overlay")
+		{
+			comparison->SetComparisonMode(itk::ValidationFilter<PixelType>::Overlay);
+		}
+		else
+		{
+			comparison->SetComparisonMode(itk::ValidationFilter<PixelType>::Checkerboard);
+		}
+		comparison->ComparisonImageOn();
+		comparison->Update();
+	}
+
+	// wait for pending writes
+	backgroundWriter->Flush();
+	backgroundWriter->Report(std::cout);
+
+	// report memory usage: the probes give the change over each level, the peak is the process high-water mark
+	std::cout << "\nMemory change per level" << std::endl;
+	memoryProbes.Report(std::cout);
+	std::cout << "Peak memory (MB)" << std::endl;
+	std::cout << "  Preprocessing : " << preprocessingPeakMemory << std::endl;
+	std::cout << "  Whole run     : " << PeakMemoryUsage() << " (registration, when above preprocessing; all jobs in batch mode)" << std::endl;
+
   return EXIT_SUCCESS;
 }
 
+// register one pair of images with the pixel type of the fixed image
+int RegisterImages( int argc, char * argv[], itk::ImageIOBase * fixedImageIO, itk::TimeProbe * startupClock,
+	const BatchJobType * job, itk::SharedImageCache * sharedImages )
+{
+  itk::ImageIOBase::IOComponentType componentType = fixedImageIO->GetComponentType();
+
+  // This filter handles all types on input, but only produces
+  // signed types
+  switch( componentType )
+    {
+    case itk::ImageIOBase::UCHAR:
+      return DoIt( argc, argv, fixedImageIO, startupClock, job, sharedImages, static_cast<unsigned char>(0) );
+      break;
+    case itk::ImageIOBase::CHAR:
+      return DoIt( argc, argv, fixedImageIO, startupClock, job, sharedImages, static_cast<signed char>(0) );
+      break;
+    case itk::ImageIOBase::USHORT:
+      return DoIt( argc, argv, fixedImageIO, startupClock, job, sharedImages, static_cast<unsigned short>(0) );
+      break;
+    case itk::ImageIOBase::SHORT:
+      return DoIt( argc, argv, fixedImageIO, startupClock, job, sharedImages, static_cast<short>(0) );
+      break;
+    case itk::ImageIOBase::UINT:
+      return DoIt( argc, argv, fixedImageIO, startupClock, job, sharedImages, static_cast<unsigned int>(0) );
+      break;
+    case itk::ImageIOBase::INT:
+      return DoIt( argc, argv, fixedImageIO, startupClock, job, sharedImages, static_cast<int>(0) );
+      break;
+    case itk::ImageIOBase::ULONG:
+      return DoIt( argc, argv, fixedImageIO, startupClock, job, sharedImages, static_cast<unsigned long>(0) );
+      break;
+    case itk::ImageIOBase::LONG:
+      return DoIt( argc, argv, fixedImageIO, startupClock, job, sharedImages, static_cast<long>(0) );
+      break;
+    case itk::ImageIOBase::FLOAT:
+      return DoIt( argc, argv, fixedImageIO, startupClock, job, sharedImages, static_cast<float>(0) );
+      break;
+    case itk::ImageIOBase::DOUBLE:
+      return DoIt( argc, argv, fixedImageIO, startupClock, job, sharedImages, static_cast<double>(0) );
+      break;
+    case itk::ImageIOBase::UNKNOWNCOMPONENTTYPE:
+    default:
+      std::cerr << "Unknown input image pixel component type: ";
+      std::cerr << itk::ImageIOBase::GetComponentTypeAsString( componentType );
+      std::cerr << std::endl;
+      return EXIT_FAILURE;
+      break;
+    }
+}
+
+// read a batch manifest: one registration per line as
+// fixedImage,movingImage,finalTransform[,fixedImageMask,movingImageMask[,debugDirectory]]
+// (empty lines and lines starting with # are skipped, lines with 4 or more than 6 fields are rejected)
+bool ReadBatchManifest( const std::string & manifestFilename, std::vector< BatchJobType > & jobs )
+{
+	std::ifstream manifest(manifestFilename.c_str());
+	if (!manifest)
+	{
+		std::cerr << "Could not open batch manifest " << manifestFilename << std::endl;
+		return false;
+	}
+
+	std::string line;
+	unsigned int lineNumber = 0;
+	while (std::getline(manifest, line))
+	{
+		++lineNumber;
+		std::vector< std::string > fields;
+		std::istringstream stream(line);
+		std::string field;
+		while (std::getline(stream, field, ','))
+		{
+			fields.push_back(itksys::SystemTools::TrimWhitespace(field));
+		}
+		if (fields.empty() || fields[0].empty() || fields[0][0] == '#')
+		{
+			continue;
+		}
+		if (fields.size() < 3 || fields.size() == 4 || fields.size() > 6)
+		{
+			std::cerr << manifestFilename << " line " << lineNumber << ": expected "
+				<< "fixedImage,movingImage,finalTransform[,fixedImageMask,movingImageMask[,debugDirectory]]" << std::endl;
+			return false;
+		}
+
+		BatchJobType job;
+		job.fixedImageFilename = fields[0];
+		job.movingImageFilename = fields[1];
+		job.finalTransform = fields[2];
+		if (fields.size() > 4)
+		{
+			job.fixedImageMaskFilename = fields[3];
+			job.movingImageMaskFilename = fields[4];
+		}
+		if (fields.size() > 5)
+		{
+			job.debugDirectory = fields[5];
+		}
+		jobs.push_back(job);
+	}
+
+	return true;
+}
+
+// run the registrations of a manifest concurrently: fixed images are read once and shared, a job
+// starts when its estimated memory fits in the budget and each job logs to <finalTransform>.log;
+// all other settings come from the command line
+int RunBatch( int argc, char * argv[], const std::string & manifestFilename, const std::string & summaryFilename,
+	int concurrency, int memoryBudget, bool biasCorrection, int biasCorrectionShrinkFactor, int parallelROIs )
+{
+	std::vector< BatchJobType > jobs;
+	if (!ReadBatchManifest(manifestFilename, jobs))
+	{
+		return EXIT_FAILURE;
+	}
+
+	// concurrent registrations share the cores
+	const unsigned int cores = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+	const unsigned int workers = std::max(1u, std::min(static_cast< unsigned int >(jobs.size()),
+		concurrency > 0 ? static_cast< unsigned int >(concurrency) : cores));
+	itk::MultiThreader::SetGlobalDefaultNumberOfThreads(std::max(1u, cores / workers));
+	std::cout << "Batch of " << jobs.size() << " registrations, " << workers << " at a time with "
+		<< std::max(1u, cores / workers) << " threads each" << std::endl;
+
+	itk::SharedImageCache::Pointer sharedImages = itk::SharedImageCache::New();
+	itk::BatchScheduler::Pointer scheduler = itk::BatchScheduler::New();
+	scheduler->SetNumberOfWorkers(workers);
+	scheduler->SetMemoryBudget(static_cast< itk::SizeValueType >(std::max(0, memoryBudget)) * 1024 * 1024);
+
+	for (unsigned int i = 0; i < jobs.size(); ++i)
+	{
+		const BatchJobType job = jobs[i];
+		const std::string name = itksys::SystemTools::GetFilenameName(job.movingImageFilename) + " -> " +
+			itksys::SystemTools::GetFilenameName(job.fixedImageFilename);
+		std::string logFilename = job.finalTransform;
+		const std::string::size_type dot = logFilename.find_last_of('.');
+		if (dot != std::string::npos && dot > logFilename.find_last_of("/\\") + 1)
+		{
+			logFilename.erase(dot);
+		}
+		logFilename += ".log";
+
+		// headers are read here, before the jobs start, to estimate the memory of each registration:
+		// - fixed image and the moving image before and after preprocessing (in the fixed pixel type)
+		// - the moving image resampled onto the fixed grid, once per parallel ROI
+		// - N4: a full size float image (cast input, then the bias field) and about six shrunk float images
+		// - label maps: fixed, moving and the moving label map resampled onto the fixed grid
+		itk::ImageIOBase::Pointer fixedImageIO;
+		itk::SizeValueType memory = 0;
+		try
+		{
+			fixedImageIO = ProbeImage(job.fixedImageFilename.c_str());
+			itk::ImageIOBase::Pointer movingImageIO = ProbeImage(job.movingImageFilename.c_str());
+			const itk::SizeValueType fixedPixels = fixedImageIO->GetImageSizeInPixels();
+			const itk::SizeValueType movingPixels = movingImageIO->GetImageSizeInPixels();
+			const itk::SizeValueType transformedImages = static_cast< itk::SizeValueType >(std::max(1, parallelROIs));
+			memory = ((1 + transformedImages) * fixedPixels + 2 * movingPixels) * fixedImageIO->GetComponentSize();
+			if (biasCorrection)
+			{
+				const itk::SizeValueType shrinkFactor = static_cast< itk::SizeValueType >(std::max(1, biasCorrectionShrinkFactor));
+				memory += (movingPixels + 6 * movingPixels / (shrinkFactor * shrinkFactor * shrinkFactor)) * sizeof(float);
+			}
+			if (!job.fixedImageMaskFilename.empty())
+			{
+				memory += 2 * fixedPixels + movingPixels;
+			}
+		}
+		catch (itk::ExceptionObject & err)
+		{
+			std::ostringstream message;
+			message << "Exception Object Caught!" << std::endl << err << std::endl;
+			const std::string text = message.str();
+			scheduler->AddJob(name, 0, logFilename, [text]() { std::cerr << text; return EXIT_FAILURE; });
+			continue;
+		}
+
+		sharedImages->Reserve(job.fixedImageFilename);
+		scheduler->AddJob(name, memory, logFilename, [argc, argv, fixedImageIO, job, sharedImages]()
+		{
+			itk::TimeProbe clock;
+			clock.Start();
+			int status = EXIT_FAILURE;
+			try
+			{
+				status = RegisterImages(argc, argv, fixedImageIO, &clock, &job, sharedImages);
+			}
+			catch (...)
+			{
+				sharedImages->Release(job.fixedImageFilename);
+				throw;
+			}
+			sharedImages->Release(job.fixedImageFilename);
+			return status;
+		});
+	}
+
+	scheduler->Run();
+
+	// summary of all registrations
+	std::cout << "\nBatch summary" << std::endl;
+	scheduler->Report(std::cout);
+
+	bool success = true;
+	const std::vector< itk::BatchScheduler::ResultType > & results = scheduler->GetResults();
+	for (unsigned int i = 0; i < results.size(); ++i)
+	{
+		success = success && results[i].status == EXIT_SUCCESS;
+	}
+
+	if (!summaryFilename.empty())
+	{
+		std::ofstream summary(summaryFilename.c_str());
+		summary << "fixedImage,movingImage,finalTransform,status,seconds,memoryMB,log" << std::endl;
+		for (unsigned int i = 0; i < results.size(); ++i)
+		{
+			summary << jobs[i].fixedImageFilename << "," << jobs[i].movingImageFilename << "," << jobs[i].finalTransform << ","
+				<< (results[i].status == EXIT_SUCCESS ? "ok" : "failed") << "," << results[i].seconds << ","
+				<< results[i].memory / (1024 * 1024) << "," << results[i].logFilename << std::endl;
+		}
+		std::cout << "Summary written to " << summaryFilename << std::endl;
+	}
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 } // end of anonymous namespace
 
 int main( int argc, char * argv[] )
 {
   PARSE_ARGS;
 
-  itk::ImageIOBase::IOPixelType     pixelType;
-  itk::ImageIOBase::IOComponentType componentType;
+  // batch mode: the registrations are listed in the manifest
+  if( !batchManifest.empty() )
+    {
+    return RunBatch( argc, argv, batchManifest, batchSummary, batchConcurrency, batchMemoryBudget,
+      biasCorrection, biasCorrectionShrinkFactor, parallelROIs );
+    }
+
+  // time from startup to the first optimizer iteration
+  itk::TimeProbe startupClock;
+  startupClock.Start();
 
   try
     {
-    itk::GetImageType(fixedImageFilename, pixelType, componentType);
-
-    // This filter handles all types on input, but only produces
-    // signed types
-    switch( componentType )
-      {
-      case itk::ImageIOBase::UCHAR:
-        return DoIt( argc, argv, static_cast<unsigned char>(0) );
-        break;
-      case itk::ImageIOBase::CHAR:
-        return DoIt( argc, argv, static_cast<signed char>(0) );
-        break;
-      case itk::ImageIOBase::USHORT:
-        return DoIt( argc, argv, static_cast<unsigned short>(0) );
-        break;
-      case itk::ImageIOBase::SHORT:
-        return DoIt( argc, argv, static_cast<short>(0) );
-        break;
-      case itk::ImageIOBase::UINT:
-        return DoIt( argc, argv, static_cast<unsigned int>(0) );
-        break;
-      case itk::ImageIOBase::INT:
-        return DoIt( argc, argv, static_cast<int>(0) );
-        break;
-      case itk::ImageIOBase::ULONG:
-        return DoIt( argc, argv, static_cast<unsigned long>(0) );
-        break;
-      case itk::ImageIOBase::LONG:
-        return DoIt( argc, argv, static_cast<long>(0) );
-        break;
-      case itk::ImageIOBase::FLOAT:
-        return DoIt( argc, argv, static_cast<float>(0) );
-        break;
-      case itk::ImageIOBase::DOUBLE:
-        return DoIt( argc, argv, static_cast<double>(0) );
-        break;
-      case itk::ImageIOBase::UNKNOWNCOMPONENTTYPE:
-      default:
-        std::cerr << "Unknown input image pixel component type: ";
-        std::cerr << itk::ImageIOBase::GetComponentTypeAsString( componentType );
-        std::cerr << std::endl;
-        return EXIT_FAILURE;
-        break;
-      }
+    // the header of the fixed image is read once and reused by DoIt
+    itk::ImageIOBase::Pointer fixedImageIO = ProbeImage(fixedImageFilename.c_str());
+    return RegisterImages( argc, argv, fixedImageIO, &startupClock, ITK_NULLPTR, ITK_NULLPTR );
     }
 
   catch( itk::ExceptionObject & excep )
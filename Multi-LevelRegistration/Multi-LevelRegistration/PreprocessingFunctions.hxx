@@ -1,6 +1,25 @@
 #include "itkDiscreteGaussianImageFilter.h"
+#include "itkSmoothingRecursiveGaussianImageFilter.h"
+#include "itkRecursiveGaussianImageFilter.h"
 #include "itkN4BiasFieldCorrectionImageFilter.h"
+#include "itkBSplineControlPointImageFilter.h"
+#include "itkShrinkImageFilter.h"
+#include "itkOtsuThresholdImageFilter.h"
+#include "itkCastImageFilter.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkMultiThreader.h"
 #include "itkThresholdImageFilter.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <itksys/SystemTools.hxx>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <limits>
 
 // templated function to threshold an image with an upper value
 template< typename ImageType > 
@@ -51,13 +70,30 @@ typename ImageType::Pointer LowerThresholdImage( typename ImageType::Pointer ima
 }
 
 // write a function to smooth an image with a gaussian image filter with specified sigma
+// the recursive (IIR) filter costs the same per voxel for any sigma; the discrete filter's kernel grows with sigma
+// up to maximumKernelWidth (ITK default 32), beyond which it is truncated
+// (sigma has always been passed to the discrete filter as its variance, so both filters use that width)
 template< typename ImageType >
-typename ImageType::Pointer SmoothImage( typename ImageType::Pointer image, float sigma )
+typename ImageType::Pointer SmoothImage( typename ImageType::Pointer image, float sigma, bool recursive = true, unsigned int maximumKernelWidth = 32 )
 {
-	typedef itk::DiscreteGaussianImageFilter< ImageType, ImageType >		SmoothingImageFilterType;
-	typename SmoothingImageFilterType::Pointer smooth = SmoothingImageFilterType::New();
+	typedef itk::ImageToImageFilter< ImageType, ImageType >	SmoothingImageFilterType;
+	typename SmoothingImageFilterType::Pointer smooth;
+	if( recursive )
+	{
+		typedef itk::SmoothingRecursiveGaussianImageFilter< ImageType, ImageType >	RecursiveGaussianFilterType;
+		typename RecursiveGaussianFilterType::Pointer recursiveSmooth = RecursiveGaussianFilterType::New();
+		recursiveSmooth->SetSigma( std::sqrt( sigma ) );
+		smooth = recursiveSmooth;
+	}
+	else
+	{
+		typedef itk::DiscreteGaussianImageFilter< ImageType, ImageType >		DiscreteGaussianFilterType;
+		typename DiscreteGaussianFilterType::Pointer discreteSmooth = DiscreteGaussianFilterType::New();
+		discreteSmooth->SetVariance( sigma );
+		discreteSmooth->SetMaximumKernelWidth( maximumKernelWidth );
+		smooth = discreteSmooth;
+	}
 	smooth->SetInput( image );
-	smooth->SetVariance( sigma );
 	
 	try
 	{
@@ -73,3 +109,512 @@ typename ImageType::Pointer SmoothImage( typename ImageType::Pointer image, floa
 	std::cout << "Image smoothed with sigma of " << sigma << std::endl;
 	return smooth->GetOutput();
 }
+
+// write a function to threshold and smooth an image in its own buffer (no additional full size images)
+// pass 1 clamps to [lowerThreshold, upperThreshold], then one in-place recursive gaussian pass per axis
+// for floating point images (thresholds/sigma <= 0 are skipped; integer images and the discrete gaussian
+// go through SmoothImage, which allocates an output)
+template< typename ImageType >
+typename ImageType::Pointer PreprocessImage( typename ImageType::Pointer image, float upperThreshold, float lowerThreshold, float sigma, bool recursive = true )
+{
+	typedef typename ImageType::PixelType	PixelType;
+
+	// clamp in place
+	if( upperThreshold > 0 || lowerThreshold > 0 )
+	{
+		const PixelType upper = upperThreshold > 0 ? static_cast< PixelType >( upperThreshold ) : itk::NumericTraits< PixelType >::max();
+		const PixelType lower = lowerThreshold > 0 ? static_cast< PixelType >( lowerThreshold ) : itk::NumericTraits< PixelType >::NonpositiveMin();
+		PixelType * buffer = image->GetBufferPointer();
+		const itk::SizeValueType numberOfPixels = image->GetBufferedRegion().GetNumberOfPixels();
+		for( itk::SizeValueType i = 0; i < numberOfPixels; ++i )
+		{
+			buffer[i] = std::min( upper, std::max( lower, buffer[i] ) );
+		}
+		// pixels changed without a filter: new modified time for the resample cache
+		image->Modified();
+
+		if( upperThreshold > 0 )
+		{
+			std::cout << "Image thresholded with threshold of " << upperThreshold << std::endl;
+		}
+		if( lowerThreshold > 0 )
+		{
+			std::cout << "Image thresholded with threshold of " << lowerThreshold << std::endl;
+		}
+	}
+
+	if( sigma <= 0 )
+	{
+		return image;
+	}
+	// integer pixels would be rounded after every axis, which biases the result downward;
+	// SmoothImage keeps the intermediate passes in real values and casts once
+	if( !recursive || itk::NumericTraits< PixelType >::is_integer )
+	{
+		return SmoothImage< ImageType >( image, sigma, recursive );
+	}
+
+	// smooth in place, one axis at a time (same width and result as SmoothImage)
+	typedef itk::RecursiveGaussianImageFilter< ImageType, ImageType >	RecursiveGaussianFilterType;
+	typename ImageType::Pointer output = image;
+	for( unsigned int d = 0; d < ImageType::ImageDimension; ++d )
+	{
+		typename RecursiveGaussianFilterType::Pointer smooth = RecursiveGaussianFilterType::New();
+		smooth->SetInput( output );
+		smooth->SetDirection( d );
+		smooth->SetSigma( std::sqrt( sigma ) );
+		smooth->SetOrder( RecursiveGaussianFilterType::ZeroOrder );
+		smooth->SetNormalizeAcrossScale( false );
+		smooth->InPlaceOn();
+
+		try
+		{
+			smooth->Update();
+		}
+		catch (itk::ExceptionObject & err)
+		{
+			std::cerr << "Exception Object Caught!" << std::endl;
+			std::cerr << err << std::endl;
+			std::cerr << std::endl;
+		}
+
+		// the output now owns the buffer of the input
+		output = smooth->GetOutput();
+		output->DisconnectPipeline();
+	}
+
+	std::cout << "Image smoothed with sigma of " << sigma << std::endl;
+	return output;
+}
+
+// N4 settings of BiasCorrectImage (part of the bias field cache key)
+const unsigned int N4SplineOrder = 3;
+const double N4WienerFilterNoise = 0.01;
+const double N4BiasFieldFullWidthAtHalfMaximum = 0.15;
+const double N4ConvergenceThreshold = 0.0000001;
+const unsigned int N4NumberOfIterations[3] = { 100, 50, 50 };
+const unsigned int N4NumberOfFittingLevels = 3;
+
+// write a function to hash a block of memory: 64 bit FNV-1a over 8 byte words in 16 MB chunks hashed on all threads,
+// then over the chunk hashes (the chunk size is fixed so the hash does not depend on the number of threads)
+inline unsigned long long HashMemory( const void * data, itk::SizeValueType numberOfBytes )
+{
+	const itk::SizeValueType chunkSize = 1 << 24;
+	const itk::SizeValueType numberOfChunks = ( numberOfBytes + chunkSize - 1 )/chunkSize;
+	const unsigned char * bytes = static_cast< const unsigned char * >( data );
+
+	std::vector< unsigned long long > chunkHashes( numberOfChunks );
+	auto hashChunks = [&]( unsigned int first, unsigned int step )
+	{
+		for( itk::SizeValueType c = first; c < numberOfChunks; c += step )
+		{
+			const unsigned char * chunk = bytes + c*chunkSize;
+			const itk::SizeValueType count = std::min( chunkSize, numberOfBytes - c*chunkSize );
+			unsigned long long hash = 14695981039346656037ULL;
+			itk::SizeValueType i = 0;
+			for( ; i + 8 <= count; i += 8 )
+			{
+				unsigned long long word;
+				std::memcpy( &word, chunk + i, 8 );
+				hash = ( hash ^ word )*1099511628211ULL;
+			}
+			for( ; i < count; ++i )
+			{
+				hash = ( hash ^ chunk[i] )*1099511628211ULL;
+			}
+			chunkHashes[c] = hash;
+		}
+	};
+
+	const unsigned int numberOfThreads = std::max( 1u, std::min( static_cast< unsigned int >( itk::MultiThreader::GetGlobalDefaultNumberOfThreads() ),
+		static_cast< unsigned int >( numberOfChunks ) ) );
+	std::vector< std::future< void > > threads;
+	for( unsigned int t = 1; t < numberOfThreads; ++t )
+	{
+		threads.push_back( std::async( std::launch::async, hashChunks, t, numberOfThreads ) );
+	}
+	hashChunks( 0, numberOfThreads );
+	for( unsigned int t = 0; t < threads.size(); ++t )
+	{
+		threads[t].get();
+	}
+
+	unsigned long long hash = 14695981039346656037ULL;
+	for( itk::SizeValueType c = 0; c < numberOfChunks; ++c )
+	{
+		hash = ( hash ^ chunkHashes[c] )*1099511628211ULL;
+	}
+	return ( hash ^ numberOfBytes )*1099511628211ULL;
+}
+
+// write a function to identify a scan for the bias field cache (hash of the pixel data, geometry and N4 settings)
+template< typename ImageType >
+std::string BiasFieldCacheKey( typename ImageType::Pointer image, unsigned int shrinkFactor )
+{
+	const itk::SizeValueType numberOfBytes = image->GetBufferedRegion().GetNumberOfPixels()*sizeof( typename ImageType::PixelType );
+	const unsigned long long dataHash = HashMemory( image->GetBufferPointer(), numberOfBytes );
+
+	// geometry and settings
+	std::ostringstream settings;
+	settings.precision( 17 );
+	settings << image->GetBufferedRegion().GetIndex() << image->GetBufferedRegion().GetSize() << image->GetOrigin() << image->GetSpacing() << image->GetDirection();
+	settings << " " << N4SplineOrder << " " << N4WienerFilterNoise << " " << N4BiasFieldFullWidthAtHalfMaximum << " " << N4ConvergenceThreshold;
+	settings << " " << N4NumberOfIterations[0] << " " << N4NumberOfIterations[1] << " " << N4NumberOfIterations[2] << " " << N4NumberOfFittingLevels;
+	const std::string text = settings.str();
+	const unsigned long long settingsHash = HashMemory( text.data(), text.size() );
+
+	std::ostringstream key;
+	key << std::hex << dataHash << "_" << settingsHash << std::dec << "_" << shrinkFactor;
+	return key.str();
+}
+
+// write a function to identify preprocessed images for the preprocessing cache
+// (hash of the input file, e.g. from HashFile, and a hash of the pixel type and every setting that changes the output)
+template< typename ImageType >
+std::string PreprocessingCacheKey( const std::string & fileHash, bool biasCorrection, unsigned int shrinkFactor,
+	float upperThreshold, float lowerThreshold, float sigma, bool recursive )
+{
+	typedef typename ImageType::PixelType	PixelType;
+
+	std::ostringstream settings;
+	settings << sizeof( PixelType ) << std::numeric_limits< PixelType >::is_integer << std::numeric_limits< PixelType >::is_signed;
+	settings << " bias " << biasCorrection;
+	if( biasCorrection )
+	{
+		settings << " " << std::max( 1u, shrinkFactor );
+	}
+	settings << " threshold " << upperThreshold << " " << lowerThreshold;
+	settings << " smoothing " << sigma << " " << recursive;
+
+	// 64 bit FNV-1a
+	const std::string text = settings.str();
+	unsigned long long hash = 14695981039346656037ULL;
+	for( std::string::size_type i = 0; i < text.size(); ++i )
+	{
+		hash = ( hash ^ static_cast< unsigned char >( text[i] ) )*1099511628211ULL;
+	}
+
+	std::ostringstream key;
+	key << fileHash << "_" << std::hex << hash;
+	return key.str();
+}
+
+// write a function to correct the bias field of an MR image with N4 (in place)
+// N4 is fit on the image shrunk by shrinkFactor using all threads, then the log bias field is reconstructed from the
+// B-spline control point lattice at full resolution; the lattice is cached in cacheDirectory (if given) so that
+// repeated runs on the same scan skip the fit (ReadWriteFunctions.hxx has to be included before this file; the
+// lattice is written like WriteOutCachedImage, to a temporary file that is renamed when complete)
+template< typename ImageType >
+typename ImageType::Pointer BiasCorrectImage( typename ImageType::Pointer image, unsigned int shrinkFactor, std::string cacheDirectory )
+{
+	typedef itk::Image< float, ImageType::ImageDimension >			RealImageType;
+	typedef itk::Image< unsigned char, ImageType::ImageDimension >	MaskImageType;
+	typedef itk::N4BiasFieldCorrectionImageFilter< RealImageType, MaskImageType, RealImageType >	CorrecterType;
+	typedef typename CorrecterType::BiasFieldControlPointLatticeType	LatticeType;
+	typedef typename CorrecterType::ScalarImageType						ScalarImageType;
+
+	shrinkFactor = std::max( 1u, shrinkFactor );
+
+	// cached lattice for this scan
+	std::string cacheFilename;
+	if( !cacheDirectory.empty() )
+	{
+		cacheFilename = cacheDirectory + "/N4Lattice_" + BiasFieldCacheKey< ImageType >( image, shrinkFactor ) + ".mha";
+	}
+
+	typename LatticeType::Pointer lattice;
+	if( !cacheFilename.empty() && itksys::SystemTools::FileExists( cacheFilename.c_str() ) )
+	{
+		typedef itk::ImageFileReader< LatticeType >	LatticeReaderType;
+		typename LatticeReaderType::Pointer reader = LatticeReaderType::New();
+		reader->SetFileName( cacheFilename );
+		try
+		{
+			reader->Update();
+			lattice = reader->GetOutput();
+			std::cout << "Bias field lattice read from " << cacheFilename << std::endl;
+		}
+		catch (itk::ExceptionObject & err)
+		{
+			std::cerr << "Exception Object Caught!" << std::endl;
+			std::cerr << err << std::endl;
+			std::cerr << std::endl;
+		}
+	}
+
+	if( !lattice )
+	{
+		// shrink the image and create an Otsu mask of it
+		typedef itk::CastImageFilter< ImageType, RealImageType >	CastFilterType;
+		typename CastFilterType::Pointer cast = CastFilterType::New();
+		cast->SetInput( image );
+
+		typedef itk::ShrinkImageFilter< RealImageType, RealImageType >	ShrinkerType;
+		typename ShrinkerType::Pointer shrinker = ShrinkerType::New();
+		shrinker->SetInput( cast->GetOutput() );
+		shrinker->SetShrinkFactors( shrinkFactor );
+
+		typedef itk::OtsuThresholdImageFilter< RealImageType, MaskImageType >	ThresholderType;
+		typename ThresholderType::Pointer otsu = ThresholderType::New();
+		otsu->SetInput( shrinker->GetOutput() );
+		otsu->SetInsideValue( 0 );
+		otsu->SetOutsideValue( 1 );
+
+		// fit the bias field on the shrunk image
+		typename CorrecterType::Pointer correcter = CorrecterType::New();
+		correcter->SetInput( shrinker->GetOutput() );
+		correcter->SetMaskImage( otsu->GetOutput() );
+		correcter->SetMaskLabel( 1 );
+		correcter->SetSplineOrder( N4SplineOrder );
+		correcter->SetWienerFilterNoise( N4WienerFilterNoise );
+		correcter->SetBiasFieldFullWidthAtHalfMaximum( N4BiasFieldFullWidthAtHalfMaximum );
+		correcter->SetConvergenceThreshold( N4ConvergenceThreshold );
+		correcter->SetNumberOfThreads( itk::MultiThreader::GetGlobalDefaultNumberOfThreads() );
+
+		typename CorrecterType::VariableSizeArrayType maximumNumberOfIterations( 3 );
+		maximumNumberOfIterations[0] = N4NumberOfIterations[0];
+		maximumNumberOfIterations[1] = N4NumberOfIterations[1];
+		maximumNumberOfIterations[2] = N4NumberOfIterations[2];
+		correcter->SetMaximumNumberOfIterations( maximumNumberOfIterations );
+		typename CorrecterType::ArrayType numberOfFittingLevels;
+		numberOfFittingLevels.Fill( N4NumberOfFittingLevels );
+		correcter->SetNumberOfFittingLevels( numberOfFittingLevels );
+
+		try
+		{
+			correcter->Update();
+		}
+		catch (itk::ExceptionObject & err)
+		{
+			std::cerr << "Exception Object Caught!" << std::endl;
+			std::cerr << err << std::endl;
+			std::cerr << std::endl;
+			return image;
+		}
+		lattice = correcter->GetLogBiasFieldControlPointLattice();
+		std::cout << "Bias field fit with shrink factor of " << shrinkFactor << std::endl;
+
+		// store the lattice for the next run
+		if( !cacheFilename.empty() )
+		{
+			typedef itk::ImageFileWriter< LatticeType >	LatticeWriterType;
+			typename LatticeWriterType::Pointer writer = LatticeWriterType::New();
+			const std::string temporaryFilename = TemporaryFilename( cacheFilename );
+			writer->SetFileName( temporaryFilename );
+			writer->SetInput( lattice );
+			try
+			{
+				writer->Update();
+
+				// rename the complete file, so other jobs on the same scan never read a partial lattice
+				itksys::SystemTools::RemoveFile( cacheFilename.c_str() );
+				if( std::rename( temporaryFilename.c_str(), cacheFilename.c_str() ) == 0 )
+				{
+					std::cout << "Bias field lattice written to " << cacheFilename << std::endl;
+				}
+				else
+				{
+					std::cerr << "Could not rename " << temporaryFilename << std::endl;
+					std::remove( temporaryFilename.c_str() );
+				}
+			}
+			catch (itk::ExceptionObject & err)
+			{
+				std::cerr << "Exception Object Caught!" << std::endl;
+				std::cerr << err << std::endl;
+				std::cerr << std::endl;
+				std::remove( temporaryFilename.c_str() );
+			}
+		}
+	}
+
+	// reconstruct the log bias field at full resolution
+	typedef itk::BSplineControlPointImageFilter< LatticeType, ScalarImageType >	BSplinerType;
+	typename BSplinerType::Pointer bspliner = BSplinerType::New();
+	bspliner->SetInput( lattice );
+	bspliner->SetSplineOrder( N4SplineOrder );
+	bspliner->SetSize( image->GetLargestPossibleRegion().GetSize() );
+	bspliner->SetOrigin( image->GetOrigin() );
+	bspliner->SetDirection( image->GetDirection() );
+	bspliner->SetSpacing( image->GetSpacing() );
+	try
+	{
+		bspliner->Update();
+	}
+	catch (itk::ExceptionObject & err)
+	{
+		std::cerr << "Exception Object Caught!" << std::endl;
+		std::cerr << err << std::endl;
+		std::cerr << std::endl;
+		return image;
+	}
+
+	// divide out the bias field in the image buffer
+	typedef typename ImageType::PixelType	PixelType;
+	PixelType * buffer = image->GetBufferPointer();
+	const typename ScalarImageType::PixelType * logField = bspliner->GetOutput()->GetBufferPointer();
+	const itk::SizeValueType numberOfPixels = image->GetBufferedRegion().GetNumberOfPixels();
+	for( itk::SizeValueType i = 0; i < numberOfPixels; ++i )
+	{
+		buffer[i] = static_cast< PixelType >( static_cast< double >( buffer[i] )/std::exp( static_cast< double >( logField[i][0] ) ) );
+	}
+	image->Modified();
+
+	std::cout << "Image bias field corrected." << std::endl;
+	return image;
+}
+
+// write a function to draw a sorted random subsample of the intensities of an image (fixed seed for repeatability)
+template< typename ImageType >
+std::vector< double > SampleIntensities( typename ImageType::Pointer image, unsigned int numberOfSamples )
+{
+	typedef itk::Statistics::MersenneTwisterRandomVariateGenerator	GeneratorType;
+	GeneratorType::Pointer generator = GeneratorType::New();
+	generator->SetSeed( 121212 );
+
+	const typename ImageType::PixelType * buffer = image->GetBufferPointer();
+	const itk::SizeValueType numberOfPixels = image->GetBufferedRegion().GetNumberOfPixels();
+	std::vector< double > samples( numberOfSamples );
+	for( unsigned int i = 0; i < numberOfSamples; ++i )
+	{
+		samples[i] = static_cast< double >( buffer[ generator->GetIntegerVariate( numberOfPixels - 1 ) ] );
+	}
+	std::sort( samples.begin(), samples.end() );
+
+	return samples;
+}
+
+// write a function to find the intensity at a fraction (0-1) of a sorted sample
+inline double SamplePercentile( const std::vector< double > & samples, double fraction )
+{
+	const double position = fraction*( samples.size() - 1 );
+	const std::size_t lower = static_cast< std::size_t >( position );
+	const std::size_t upper = std::min( lower + 1, samples.size() - 1 );
+	return samples[lower] + ( position - lower )*( samples[upper] - samples[lower] );
+}
+
+// write a function to evaluate a piecewise linear mapping through the control points (source -> target)
+// values beyond the end points are clamped (clamp) or follow the end segments
+inline double MapIntensity( const std::vector< double > & source, const std::vector< double > & target, double value, bool clamp )
+{
+	const std::size_t last = source.size() - 1;
+	if( clamp && value <= source[0] )
+	{
+		return target[0];
+	}
+	if( clamp && value >= source[last] )
+	{
+		return target[last];
+	}
+
+	std::size_t k = std::upper_bound( source.begin(), source.end(), value ) - source.begin();
+	k = std::min( std::max( k, static_cast< std::size_t >( 1 ) ), last );
+	const double width = source[k] - source[k-1];
+	if( width <= 0 )
+	{
+		return target[k];
+	}
+	return target[k-1] + ( value - source[k-1] )*( target[k] - target[k-1] )/width;
+}
+
+// write a function to apply a piecewise linear intensity mapping in place through a lookup table
+// 8/16 bit integer images index a table over the whole pixel range; other types interpolate a 4096 entry table
+template< typename ImageType >
+void ApplyIntensityMapping( typename ImageType::Pointer image, const std::vector< double > & source, const std::vector< double > & target, bool clamp )
+{
+	typedef typename ImageType::PixelType	PixelType;
+	PixelType * buffer = image->GetBufferPointer();
+	const itk::SizeValueType numberOfPixels = image->GetBufferedRegion().GetNumberOfPixels();
+
+	if( std::numeric_limits< PixelType >::is_integer && sizeof( PixelType ) <= 2 )
+	{
+		// one entry per pixel value
+		const long minimum = static_cast< long >( std::numeric_limits< PixelType >::min() );
+		const long maximum = static_cast< long >( std::numeric_limits< PixelType >::max() );
+		std::vector< PixelType > table( maximum - minimum + 1 );
+		for( long v = minimum; v <= maximum; ++v )
+		{
+			const double mapped = MapIntensity( source, target, static_cast< double >( v ), clamp );
+			table[v - minimum] = static_cast< PixelType >( std::min( static_cast< double >( maximum ), std::max( static_cast< double >( minimum ), mapped + 0.5*( mapped >= 0 ? 1 : -1 ) ) ) );
+		}
+
+		const PixelType * lookup = &table[0] - minimum;
+		for( itk::SizeValueType i = 0; i < numberOfPixels; ++i )
+		{
+			buffer[i] = lookup[ static_cast< long >( buffer[i] ) ];
+		}
+	}
+	else
+	{
+		// table over the control point range, interpolated between entries
+		const unsigned int numberOfEntries = 4096;
+		const double lower = source.front();
+		const double upper = source.back();
+		const double step = upper > lower ? ( upper - lower )/( numberOfEntries - 1 ) : 1.0;
+		std::vector< double > table( numberOfEntries );
+		for( unsigned int e = 0; e < numberOfEntries; ++e )
+		{
+			table[e] = MapIntensity( source, target, lower + e*step, clamp );
+		}
+
+		const double inverseStep = 1.0/step;
+		for( itk::SizeValueType i = 0; i < numberOfPixels; ++i )
+		{
+			const double value = static_cast< double >( buffer[i] );
+			if( value < lower || value > upper )
+			{
+				buffer[i] = static_cast< PixelType >( MapIntensity( source, target, value, clamp ) );
+				continue;
+			}
+			const double position = ( value - lower )*inverseStep;
+			const unsigned int e = std::min( static_cast< unsigned int >( position ), numberOfEntries - 2 );
+			buffer[i] = static_cast< PixelType >( table[e] + ( position - e )*( table[e+1] - table[e] ) );
+		}
+	}
+
+	// pixels changed without a filter: new modified time for the resample cache
+	image->Modified();
+	return;
+}
+
+// write a function to rescale an image in place so the lower/upper percentiles of a random subsample map to 0 and 1000
+// (or to 0 and the largest pixel value for pixel types that cannot hold 1000, e.g. 8 bit images)
+template< typename ImageType >
+typename ImageType::Pointer NormalizeImage( typename ImageType::Pointer image, unsigned int numberOfSamples, double lowerPercentile, double upperPercentile )
+{
+	typedef typename ImageType::PixelType	PixelType;
+	const std::vector< double > samples = SampleIntensities< ImageType >( image, numberOfSamples );
+
+	std::vector< double > source( 2 ), target( 2 );
+	source[0] = SamplePercentile( samples, lowerPercentile/100.0 );
+	source[1] = SamplePercentile( samples, upperPercentile/100.0 );
+	target[0] = 0.0;
+	target[1] = std::min( 1000.0, static_cast< double >( itk::NumericTraits< PixelType >::max() ) );
+	ApplyIntensityMapping< ImageType >( image, source, target, true );
+
+	std::cout << "Image normalized from [" << source[0] << ", " << source[1] << "] to [0, " << target[1] << "]" << std::endl;
+	return image;
+}
+
+// write a function to match the histogram of an image to a reference image in place using quantiles of random subsamples
+template< typename ImageType >
+typename ImageType::Pointer MatchHistogram( typename ImageType::Pointer image, typename ImageType::Pointer reference, unsigned int numberOfSamples,
+	unsigned int numberOfMatchPoints, double lowerPercentile, double upperPercentile )
+{
+	const std::vector< double > samples = SampleIntensities< ImageType >( image, numberOfSamples );
+	const std::vector< double > referenceSamples = SampleIntensities< ImageType >( reference, numberOfSamples );
+
+	// match points evenly spaced between the percentiles (including both ends)
+	const unsigned int numberOfPoints = numberOfMatchPoints + 2;
+	std::vector< double > source( numberOfPoints ), target( numberOfPoints );
+	for( unsigned int k = 0; k < numberOfPoints; ++k )
+	{
+		const double fraction = ( lowerPercentile + k*( upperPercentile - lowerPercentile )/( numberOfPoints - 1 ) )/100.0;
+		source[k] = SamplePercentile( samples, fraction );
+		target[k] = SamplePercentile( referenceSamples, fraction );
+	}
+	ApplyIntensityMapping< ImageType >( image, source, target, false );
+
+	std::cout << "Image histogram matched with " << numberOfMatchPoints << " match points" << std::endl;
+	return image;
+}
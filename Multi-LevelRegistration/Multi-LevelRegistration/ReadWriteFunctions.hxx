@@ -1,10 +1,13 @@
 /*
 list of functions in file
-1. ReadInImage
-2. WriteOutImage
+1. ReadInImage (memory-mapped for uncompressed images of matching pixel type)
+2. WriteOutImage (no copy when the pixel types match)/WriteOutCompressedImage (debug .nrrd gzip compressed on all threads)
 3. ReadFiducial ***will need modifications***
 4. PrintFiducials
 5. WriteOutTransform
+6. WriteOutImageInBackground/WriteOutTransformInBackground (queued on a BackgroundWriter)
+7. HashFile/ReadInCachedImage/WriteOutCachedImage (cache of preprocessed images)
+8. ReadInPointSet/WriteOutPointSet (large point sets as contiguous arrays: .fcsv, .csv, binary .bpts)
 
 */
 
@@ -13,18 +16,285 @@ list of functions in file
 #include "itkCastImageFilter.h"
 #include "itkTransformFileReader.h"
 #include "itkTransformFileWriter.h"
+#include "itkImageIOFactory.h"
+#include "itkByteSwapper.h"
+#include "itkMemoryMappedImageContainer.h"
+#include "itkParallelCompressedImageWriter.h"
+#include "itkBackgroundWriter.h"
+#include "itkBatchScheduler.h"
 
 #include <itksys/SystemTools.hxx>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+// Write a function to locate the raw pixel data of an uncompressed MetaImage (.mha/.mhd) or NRRD (.nrrd/.nhdr) file
+// returns false for compressed/encoded data, multi-file data, or other formats
+inline bool LocateRawImageData( const std::string & filename, itk::SizeValueType dataSize, std::string & dataFilename, itk::SizeValueType & offset )
+{
+	const std::string extension = itksys::SystemTools::LowerCase( itksys::SystemTools::GetFilenameLastExtension( filename ) );
+	// directory of the header for relative data files (empty for a header in the current directory)
+	const std::string path = itksys::SystemTools::GetFilenamePath( filename );
+	const std::string directory = path.empty() ? path : path + "/";
+	std::ifstream header( filename.c_str(), std::ios::in | std::ios::binary );
+	if( !header )
+	{
+		return false;
+	}
+
+	// header values that move the start of the data
+	long headerSize = 0;
+	dataFilename.clear();
+	std::string line;
+	if( extension == ".mha" || extension == ".mhd" )
+	{
+		while( std::getline( header, line ) )
+		{
+			const std::string::size_type equal = line.find( '=' );
+			if( equal == std::string::npos )
+			{
+				continue;
+			}
+			const std::string key = itksys::SystemTools::TrimWhitespace( line.substr( 0, equal ) );
+			const std::string value = itksys::SystemTools::TrimWhitespace( line.substr( equal + 1 ) );
+			if( key == "CompressedData" && itksys::SystemTools::LowerCase( value ) == "true" )
+			{
+				return false;
+			}
+			else if( key == "HeaderSize" )
+			{
+				headerSize = atol( value.c_str() );
+			}
+			else if( key == "ElementDataFile" )
+			{
+				// ElementDataFile is always the last line of the header
+				if( value == "LOCAL" )
+				{
+					dataFilename = filename;
+					offset = static_cast< itk::SizeValueType >( header.tellg() );
+				}
+				else if( value == "LIST" || value.find( '%' ) != std::string::npos || value.find( ' ' ) != std::string::npos )
+				{
+					return false;
+				}
+				else
+				{
+					dataFilename = itksys::SystemTools::FileIsFullPath( value.c_str() ) ? value : directory + value;
+					offset = 0;
+				}
+				break;
+			}
+		}
+	}
+	else if( extension == ".nrrd" || extension == ".nhdr" )
+	{
+		bool raw = false;
+		while( std::getline( header, line ) )
+		{
+			// a blank line ends the header
+			if( line.empty() || line == "\r" )
+			{
+				break;
+			}
+			const std::string::size_type colon = line.find( ':' );
+			if( colon == std::string::npos || line[0] == '#' )
+			{
+				continue;
+			}
+			const std::string key = itksys::SystemTools::TrimWhitespace( line.substr( 0, colon ) );
+			std::string value = line.substr( colon + 1 );
+			if( !value.empty() && value[0] == '=' )
+			{
+				continue;	// key/value pair
+			}
+			value = itksys::SystemTools::TrimWhitespace( value );
+			if( key == "encoding" )
+			{
+				raw = ( value == "raw" );
+			}
+			else if( key == "byte skip" )
+			{
+				headerSize = atol( value.c_str() );
+			}
+			else if( key == "line skip" && atol( value.c_str() ) != 0 )
+			{
+				return false;
+			}
+			else if( key == "data file" || key == "datafile" )
+			{
+				if( value.find( ' ' ) != std::string::npos || value.find( '%' ) != std::string::npos || value == "LIST" )
+				{
+					return false;
+				}
+				dataFilename = itksys::SystemTools::FileIsFullPath( value.c_str() ) ? value : directory + value;
+			}
+		}
+		if( !raw )
+		{
+			return false;
+		}
+		if( dataFilename.empty() )
+		{
+			dataFilename = filename;
+			offset = static_cast< itk::SizeValueType >( header.tellg() );
+		}
+		else
+		{
+			offset = 0;
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	if( dataFilename.empty() || !itksys::SystemTools::FileExists( dataFilename.c_str() ) )
+	{
+		return false;
+	}
+
+	// a header size of -1 means the data sits at the end of the file
+	if( headerSize == -1 )
+	{
+		const itk::SizeValueType fileSize = static_cast< itk::SizeValueType >( itksys::SystemTools::FileLength( dataFilename.c_str() ) );
+		if( fileSize < dataSize )
+		{
+			return false;
+		}
+		offset = fileSize - dataSize;
+	}
+	else if( headerSize > 0 )
+	{
+		offset += static_cast< itk::SizeValueType >( headerSize );
+	}
+
+	return true;
+}
+
+// Write a function to read the header of an image once (the returned ImageIO can be passed to ReadInImage)
+inline itk::ImageIOBase::Pointer ProbeImage( const char * ImageFilename )
+{
+	itk::ImageIOBase::Pointer io = itk::ImageIOFactory::CreateImageIO( ImageFilename, itk::ImageIOFactory::ReadMode );
+	if( !io )
+	{
+		itkGenericExceptionMacro( << "Could not create IO object for reading file " << ImageFilename );
+	}
+	io->SetFileName( ImageFilename );
+	io->ReadImageInformation();
+
+	return io;
+}
+
+// Write a function to read in an image by mapping its pixel data into memory (no copy, pages read on demand)
+// returns a null pointer if the file is compressed, byte swapped, its pixel type differs from ImageType,
+// or the pixel data does not start at a multiple of the pixel size (the pixels would be misaligned)
+// (the header is only read if no probed ImageIO is given)
+template<typename ImageType>
+typename ImageType::Pointer ReadInImageMapped( const char * ImageFilename, itk::ImageIOBase * probedIO = ITK_NULLPTR )
+{
+	typedef typename ImageType::PixelType	PixelType;
+	const unsigned int dimension = ImageType::ImageDimension;
+
+	// header information from ITK
+	itk::ImageIOBase::Pointer io = probedIO;
+	if( !io || io->GetFileName() != std::string( ImageFilename ) )
+	{
+		try
+		{
+			io = ProbeImage( ImageFilename );
+		}
+		catch(itk::ExceptionObject &)
+		{
+			return ITK_NULLPTR;
+		}
+	}
+
+	// only data that can be used as is
+	const itk::ImageIOBase::ByteOrder nativeOrder = itk::ByteSwapper< PixelType >::SystemIsBigEndian() ? itk::ImageIOBase::BigEndian : itk::ImageIOBase::LittleEndian;
+	if( io->GetNumberOfDimensions() != dimension || io->GetNumberOfComponents() != 1 ||
+		io->GetComponentTypeInfo() != typeid( PixelType ) ||
+		( sizeof( PixelType ) > 1 && io->GetByteOrder() != nativeOrder ) )
+	{
+		return ITK_NULLPTR;
+	}
+
+	typename ImageType::RegionType region;
+	typename ImageType::SpacingType spacing;
+	typename ImageType::PointType origin;
+	typename ImageType::DirectionType direction;
+	for( unsigned int i = 0; i < dimension; ++i )
+	{
+		region.SetSize( i, io->GetDimensions( i ) );
+		region.SetIndex( i, 0 );
+		spacing[i] = io->GetSpacing( i );
+		origin[i] = io->GetOrigin( i );
+		const std::vector< double > axis = io->GetDirection( i );
+		for( unsigned int j = 0; j < dimension; ++j )
+		{
+			direction[j][i] = axis[j];
+		}
+	}
+
+	// map the pixel data
+	const itk::SizeValueType numberOfPixels = region.GetNumberOfPixels();
+	std::string dataFilename;
+	itk::SizeValueType offset = 0;
+	if( !LocateRawImageData( ImageFilename, numberOfPixels*sizeof( PixelType ), dataFilename, offset ) ||
+		offset % sizeof( PixelType ) != 0 )
+	{
+		return ITK_NULLPTR;
+	}
+
+	typedef itk::MemoryMappedImageContainer< itk::SizeValueType, PixelType >	ContainerType;
+	typename ContainerType::Pointer container = ContainerType::New();
+	if( !container->MapFile( dataFilename, offset, numberOfPixels ) )
+	{
+		return ITK_NULLPTR;
+	}
+
+	typename ImageType::Pointer image = ImageType::New();
+	image->SetRegions( region );
+	image->SetSpacing( spacing );
+	image->SetOrigin( origin );
+	image->SetDirection( direction );
+	image->SetPixelContainer( container );
+
+	return image;
+}
 
 // Write a function to read in images templated over dimension and pixel type
+// (an ImageIO from ProbeImage avoids probing the file format again)
 template<typename ImageType>
-typename ImageType::Pointer ReadInImage( const char * ImageFilename )
+typename ImageType::Pointer ReadInImage( const char * ImageFilename, itk::ImageIOBase * probedIO = ITK_NULLPTR )
 {
+	// uncompressed images of the same pixel type are mapped instead of copied
+	typename ImageType::Pointer mapped = ReadInImageMapped< ImageType >( ImageFilename, probedIO );
+	if( mapped )
+	{
+		return mapped;
+	}
+
 	typedef itk::ImageFileReader<ImageType>		ReaderType;	
 	typename ReaderType::Pointer reader = ReaderType::New();
 	reader->SetFileName( ImageFilename );
+	if( probedIO && probedIO->GetFileName() == std::string( ImageFilename ) )
+	{
+		reader->SetImageIO( probedIO );
+	}
 	
 	// update reader
 	try
@@ -38,22 +308,218 @@ typename ImageType::Pointer ReadInImage( const char * ImageFilename )
 		std::cerr << std::endl;
 	}
 	
+	// return output (detached from the reader, so pipelines of other threads never update it again)
+	typename ImageType::Pointer image = reader->GetOutput();
+	image->DisconnectPipeline();
+	return image;
+}
+
+// Write a function to read only the geometry of an image (no pixel buffer is allocated)
+template<typename ImageType>
+typename ImageType::Pointer ReadInImageInformation( const char * ImageFilename )
+{
+	typedef itk::ImageFileReader<ImageType>		ReaderType;	
+	typename ReaderType::Pointer reader = ReaderType::New();
+	reader->SetFileName( ImageFilename );
+	
+	// read the header only
+	try
+	{
+		reader->UpdateOutputInformation();
+	}
+	catch(itk::ExceptionObject & err)
+	{
+		std::cerr << "Exception Object Caught!" << std::endl;
+		std::cerr << err << std::endl;
+		std::cerr << std::endl;
+	}
+	
 	// return output
-	return reader->GetOutput();
+	typename ImageType::Pointer image = reader->GetOutput();
+	image->DisconnectPipeline();
+	return image;
 }
 
-// Write a function to write out images
+// hash the contents of one file into a running 64 bit FNV-1a hash (8 byte words)
+inline void HashFileContents( const std::string & filename, unsigned long long & hash, unsigned long long & length )
+{
+	std::ifstream file( filename.c_str(), std::ios::binary );
+	if( !file )
+	{
+		itkGenericExceptionMacro( << "Could not open " << filename );
+	}
+
+	std::vector< char > buffer( 1 << 22 );
+	while( file )
+	{
+		file.read( &buffer[0], buffer.size() );
+		const std::streamsize count = file.gcount();
+		std::streamsize i = 0;
+		for( ; i + 8 <= count; i += 8 )
+		{
+			unsigned long long word;
+			std::memcpy( &word, &buffer[i], 8 );
+			hash = ( hash ^ word )*1099511628211ULL;
+		}
+		for( ; i < count; ++i )
+		{
+			hash = ( hash ^ static_cast< unsigned char >( buffer[i] ) )*1099511628211ULL;
+		}
+		length += count;
+	}
+}
+
+// Write a function to hash the contents of an image file (hex string)
+// the data file of a detached header is hashed with the header; an empty string is returned when a
+// detached .mhd/.nhdr data file cannot be located (compressed or multi-file data), so nothing is cached
+inline std::string HashFile( const char * filename )
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	unsigned long long length = 0;
+	HashFileContents( filename, hash, length );
+
+	std::string dataFilename;
+	itk::SizeValueType offset = 0;
+	if( LocateRawImageData( filename, 0, dataFilename, offset ) )
+	{
+		if( dataFilename != filename )
+		{
+			HashFileContents( dataFilename, hash, length );
+		}
+	}
+	else
+	{
+		const std::string extension = itksys::SystemTools::LowerCase( itksys::SystemTools::GetFilenameLastExtension( filename ) );
+		if( extension == ".mhd" || extension == ".nhdr" )
+		{
+			return std::string();
+		}
+	}
+
+	std::ostringstream key;
+	key << std::hex << hash << "_" << length;
+	return key.str();
+}
+
+// header of the cached image format: pixel layout and geometry followed by the raw pixels (native byte order)
+// the pixel data starts at a multiple of 64 bytes so that it can be mapped
+template<typename ImageType>
+itk::SizeValueType CachedImageHeaderSize()
+{
+	const unsigned int dimension = ImageType::ImageDimension;
+	const itk::SizeValueType size = 8 + 5*sizeof( unsigned int ) + dimension*sizeof( unsigned long long ) + ( 2*dimension + dimension*dimension )*sizeof( double );
+	return ( size + 63 )/64*64;
+}
+
+inline const char * CachedImageMagic()
+{
+	return "ITKCACH1";
+}
+
+// Write a function to read in an image written by WriteOutCachedImage (pixels are mapped, not copied)
+// returns a null pointer if the file does not exist or does not match ImageType
+template<typename ImageType>
+typename ImageType::Pointer ReadInCachedImage( const char * ImageFilename )
+{
+	typedef typename ImageType::PixelType	PixelType;
+	const unsigned int dimension = ImageType::ImageDimension;
+
+	std::FILE * file = std::fopen( ImageFilename, "rb" );
+	if( !file )
+	{
+		return ITK_NULLPTR;
+	}
+
+	// pixel layout
+	char magic[8];
+	unsigned int layout[5];
+	const unsigned int expected[5] = { 0x01020304, dimension, sizeof( PixelType ),
+		std::numeric_limits< PixelType >::is_integer, std::numeric_limits< PixelType >::is_signed };
+	bool valid = std::fread( magic, 1, 8, file ) == 8 && std::memcmp( magic, CachedImageMagic(), 8 ) == 0 &&
+		std::fread( layout, sizeof( unsigned int ), 5, file ) == 5 && std::memcmp( layout, expected, sizeof( layout ) ) == 0;
+
+	// geometry
+	std::vector< unsigned long long > size( dimension );
+	std::vector< double > geometry( 2*dimension + dimension*dimension );
+	valid = valid && std::fread( &size[0], sizeof( unsigned long long ), dimension, file ) == dimension &&
+		std::fread( &geometry[0], sizeof( double ), geometry.size(), file ) == geometry.size();
+	std::fclose( file );
+	if( !valid )
+	{
+		return ITK_NULLPTR;
+	}
+
+	typename ImageType::RegionType region;
+	typename ImageType::SpacingType spacing;
+	typename ImageType::PointType origin;
+	typename ImageType::DirectionType direction;
+	for( unsigned int i = 0; i < dimension; ++i )
+	{
+		region.SetSize( i, size[i] );
+		region.SetIndex( i, 0 );
+		spacing[i] = geometry[i];
+		origin[i] = geometry[dimension + i];
+		for( unsigned int j = 0; j < dimension; ++j )
+		{
+			direction[i][j] = geometry[2*dimension + i*dimension + j];
+		}
+	}
+
+	// map the pixel data
+	typedef itk::MemoryMappedImageContainer< itk::SizeValueType, PixelType >	ContainerType;
+	typename ContainerType::Pointer container = ContainerType::New();
+	if( !container->MapFile( ImageFilename, CachedImageHeaderSize< ImageType >(), region.GetNumberOfPixels() ) )
+	{
+		return ITK_NULLPTR;
+	}
+
+	typename ImageType::Pointer image = ImageType::New();
+	image->SetRegions( region );
+	image->SetSpacing( spacing );
+	image->SetOrigin( origin );
+	image->SetDirection( direction );
+	image->SetPixelContainer( container );
+
+	return image;
+}
+
+// Write a function to connect an image to a writer as outputImageType
+// images that already have the output type are passed as is (no copy); other types go through a cast filter
+// (held by filter) that is left un-updated so that the writer can stream it
 template<typename inputImageType, typename outputImageType>
-int WriteOutImage( const char * ImageFilename, typename inputImageType::Pointer image )
+typename outputImageType::Pointer ImageForWriting( typename inputImageType::Pointer image, itk::ProcessObject::Pointer &, std::true_type )
+{
+	return image;
+}
+
+template<typename inputImageType, typename outputImageType>
+typename outputImageType::Pointer ImageForWriting( typename inputImageType::Pointer image, itk::ProcessObject::Pointer & filter, std::false_type )
 {
 	typedef itk::CastImageFilter<inputImageType, outputImageType> CastFilterType;
 	typename CastFilterType::Pointer caster = CastFilterType::New();
 	caster->SetInput( image );
+	filter = caster;
+	return caster->GetOutput();
+}
+
+// Write a function to write out images
+template<typename inputImageType, typename outputImageType>
+int WriteOutImage( const char * ImageFilename, typename inputImageType::Pointer image )
+{
+	typedef typename std::is_same<inputImageType, outputImageType>::type SameTypeType;
+	itk::ProcessObject::Pointer caster;
+	typename outputImageType::Pointer output = ImageForWriting<inputImageType, outputImageType>( image, caster, SameTypeType() );
 
 	typedef itk::ImageFileWriter<outputImageType> WriterType;
 	typename WriterType::Pointer writer = WriterType::New();
 	writer->SetFileName( ImageFilename );
-	writer->SetInput( caster->GetOutput() );
+	writer->SetInput( output );
+
+	// cast in pieces for formats that support streamed writing
+	if( !SameTypeType::value )
+	{
+		writer->SetNumberOfStreamDivisions( 20 );
+	}
 
 	// update the writer
 	try
@@ -71,6 +537,92 @@ int WriteOutImage( const char * ImageFilename, typename inputImageType::Pointer
 	return EXIT_SUCCESS;
 }
 
+// Write a function to name a temporary file next to a cache file (unique per process and thread, same extension)
+// cache files are written under this name and renamed when complete, so concurrent jobs never read a partial file
+inline std::string TemporaryFilename( const std::string & filename )
+{
+	const std::string::size_type slash = filename.find_last_of( "/\\" );
+	std::string::size_type dot = filename.rfind( '.' );
+	if( dot == std::string::npos || ( slash != std::string::npos && dot < slash ) )
+	{
+		dot = filename.size();
+	}
+
+	std::ostringstream temporaryName;
+#ifdef _WIN32
+	temporaryName << filename.substr( 0, dot ) << ".tmp." << _getpid();
+#else
+	temporaryName << filename.substr( 0, dot ) << ".tmp." << getpid();
+#endif
+	temporaryName << "." << std::hex << std::hash< std::thread::id >()( std::this_thread::get_id() ) << filename.substr( dot );
+	return temporaryName.str();
+}
+
+// Write a function to write out an image in the cached image format (see ReadInCachedImage)
+// the file is written under a temporary name unique to the process and thread and then renamed,
+// so concurrent writers of the same key do not share a partial file
+template<typename ImageType>
+int WriteOutCachedImage( const char * ImageFilename, typename ImageType::Pointer image )
+{
+	typedef typename ImageType::PixelType	PixelType;
+	const unsigned int dimension = ImageType::ImageDimension;
+
+	// header
+	std::vector< char > header( CachedImageHeaderSize< ImageType >(), 0 );
+	char * position = &header[0];
+	std::memcpy( position, CachedImageMagic(), 8 );
+	position += 8;
+	const unsigned int layout[5] = { 0x01020304, dimension, sizeof( PixelType ),
+		std::numeric_limits< PixelType >::is_integer, std::numeric_limits< PixelType >::is_signed };
+	std::memcpy( position, layout, sizeof( layout ) );
+	position += sizeof( layout );
+
+	const typename ImageType::RegionType region = image->GetBufferedRegion();
+	std::vector< unsigned long long > size( dimension );
+	std::vector< double > geometry( 2*dimension + dimension*dimension );
+	for( unsigned int i = 0; i < dimension; ++i )
+	{
+		size[i] = region.GetSize()[i];
+		geometry[i] = image->GetSpacing()[i];
+		geometry[dimension + i] = image->GetOrigin()[i];
+		for( unsigned int j = 0; j < dimension; ++j )
+		{
+			geometry[2*dimension + i*dimension + j] = image->GetDirection()[i][j];
+		}
+	}
+	std::memcpy( position, &size[0], size.size()*sizeof( unsigned long long ) );
+	position += size.size()*sizeof( unsigned long long );
+	std::memcpy( position, &geometry[0], geometry.size()*sizeof( double ) );
+
+	// header and pixels
+	const std::string temporaryFilename = TemporaryFilename( ImageFilename );
+	std::FILE * file = std::fopen( temporaryFilename.c_str(), "wb" );
+	if( !file )
+	{
+		std::cerr << "Could not write " << temporaryFilename << std::endl;
+		return EXIT_FAILURE;
+	}
+	const itk::SizeValueType numberOfPixels = region.GetNumberOfPixels();
+	const bool written = std::fwrite( &header[0], 1, header.size(), file ) == header.size() &&
+		std::fwrite( image->GetBufferPointer(), sizeof( PixelType ), numberOfPixels, file ) == numberOfPixels;
+	if( std::fclose( file ) != 0 || !written )
+	{
+		std::cerr << "Could not write " << temporaryFilename << std::endl;
+		std::remove( temporaryFilename.c_str() );
+		return EXIT_FAILURE;
+	}
+
+	itksys::SystemTools::RemoveFile( ImageFilename );
+	if( std::rename( temporaryFilename.c_str(), ImageFilename ) != 0 )
+	{
+		std::cerr << "Could not rename " << temporaryFilename << std::endl;
+		std::remove( temporaryFilename.c_str() );
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
 // Write a function to read in the fiducials (from Slicer) for each image
 template<typename PointType, typename LandmarksType>
 typename LandmarksType ReadFiducial( const char * fiducialFilename )
@@ -138,6 +690,208 @@ int printFiducials( LandmarksType landmarks )
 	return EXIT_SUCCESS;
 }
 
+// Write a function to read in a point set into a contiguous array (x0 y0 z0 x1 y1 z1 ..., LPS)
+// formats by extension:
+//   .fcsv   Slicer fiducials, coordinates in columns 2-4 (RAS unless the header says LPS), '#' lines skipped
+//   .csv    x,y,z in the first three columns (LPS), lines that do not start with a number are skipped
+//   .bpts   binary: char[8] "ITKPTS01", uint64 number of points, double coordinates (native byte order)
+// text files are parsed in fixed-size chunks, so memory use is the array plus one chunk
+// returns the number of points (points is emptied if the file cannot be read)
+inline itk::SizeValueType ReadInPointSet( const char * pointSetFilename, std::vector< double > & points )
+{
+	points.clear();
+	const std::string extension = itksys::SystemTools::LowerCase( itksys::SystemTools::GetFilenameLastExtension( pointSetFilename ) );
+
+	std::FILE * file = std::fopen( pointSetFilename, "rb" );
+	if( !file )
+	{
+		std::cerr << "Could not open " << pointSetFilename << std::endl;
+		return 0;
+	}
+
+	// binary points are read in one call
+	if( extension == ".bpts" )
+	{
+		char magic[8];
+		unsigned long long numberOfPoints = 0;
+		if( std::fread( magic, 1, 8, file ) != 8 || std::memcmp( magic, "ITKPTS01", 8 ) != 0 ||
+			std::fread( &numberOfPoints, sizeof( unsigned long long ), 1, file ) != 1 )
+		{
+			std::cerr << pointSetFilename << " is not a point set" << std::endl;
+			std::fclose( file );
+			return 0;
+		}
+		points.resize( 3*numberOfPoints );
+		if( numberOfPoints > 0 && std::fread( &points[0], sizeof( double ), points.size(), file ) != points.size() )
+		{
+			std::cerr << "Truncated point set " << pointSetFilename << std::endl;
+			points.clear();
+		}
+		std::fclose( file );
+		return points.size()/3;
+	}
+
+	const bool fiducials = extension == ".fcsv";
+	const unsigned int firstColumn = fiducials ? 1 : 0;
+	bool ras = fiducials;
+
+	// parse complete lines of each chunk; a partial last line is moved to the front of the buffer
+	std::vector< char > buffer( 1 << 22 );
+	std::size_t filled = 0;
+	bool endOfFile = false;
+	while( !endOfFile || filled > 0 )
+	{
+		if( !endOfFile )
+		{
+			if( filled == buffer.size() - 1 )
+			{
+				buffer.resize( 2*buffer.size() );
+			}
+			const std::size_t count = std::fread( &buffer[filled], 1, buffer.size() - 1 - filled, file );
+			filled += count;
+			endOfFile = count == 0;
+		}
+
+		char * begin = &buffer[0];
+		char * const end = begin + filled;
+		while( begin < end )
+		{
+			char * lineEnd = static_cast< char * >( std::memchr( begin, '\n', end - begin ) );
+			if( !lineEnd )
+			{
+				if( !endOfFile )
+				{
+					break;
+				}
+				lineEnd = end;
+			}
+			*lineEnd = '\0';
+
+			if( *begin == '#' )
+			{
+				// Slicer 4.6+ writes the coordinate system in the header
+				if( std::strstr( begin, "CoordinateSystem" ) && ( std::strstr( begin, "LPS" ) || std::strstr( begin, "= 1" ) ) )
+				{
+					ras = false;
+				}
+			}
+			else
+			{
+				// skip to the first coordinate column
+				char * position = begin;
+				for( unsigned int c = 0; c < firstColumn && position; ++c )
+				{
+					position = std::strchr( position, ',' );
+					position = position ? position + 1 : ITK_NULLPTR;
+				}
+
+				double point[3];
+				unsigned int i = 0;
+				for( ; position && i < 3; ++i )
+				{
+					char * next;
+					point[i] = std::strtod( position, &next );
+					if( next == position )
+					{
+						break;
+					}
+					position = std::strchr( next, ',' );
+					position = position ? position + 1 : ITK_NULLPTR;
+				}
+				if( i == 3 )
+				{
+					if( ras ) // negate first two components for RAS->LPS
+					{
+						point[0] *= -1;
+						point[1] *= -1;
+					}
+					points.insert( points.end(), point, point + 3 );
+				}
+			}
+			begin = lineEnd + 1;
+		}
+
+		// keep the partial line
+		filled = begin < end ? static_cast< std::size_t >( end - begin ) : 0;
+		if( filled > 0 )
+		{
+			std::memmove( &buffer[0], begin, filled );
+		}
+	}
+	std::fclose( file );
+
+	return points.size()/3;
+}
+
+// Write a function to write out a point set from a contiguous array (x0 y0 z0 x1 y1 z1 ..., LPS)
+// (same formats as ReadInPointSet; .fcsv is written in RAS with labels F-1, F-2, ...)
+inline int WriteOutPointSet( const char * pointSetFilename, const std::vector< double > & points )
+{
+	const std::string extension = itksys::SystemTools::LowerCase( itksys::SystemTools::GetFilenameLastExtension( pointSetFilename ) );
+	const itk::SizeValueType numberOfPoints = points.size()/3;
+
+	std::FILE * file = std::fopen( pointSetFilename, "wb" );
+	if( !file )
+	{
+		std::cerr << "Could not write " << pointSetFilename << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	bool written = true;
+	if( extension == ".bpts" )
+	{
+		const unsigned long long count = numberOfPoints;
+		written = std::fwrite( "ITKPTS01", 1, 8, file ) == 8 && std::fwrite( &count, sizeof( unsigned long long ), 1, file ) == 1 &&
+			( numberOfPoints == 0 || std::fwrite( &points[0], sizeof( double ), 3*numberOfPoints, file ) == 3*numberOfPoints );
+	}
+	else
+	{
+		// lines are formatted into a large buffer to limit the number of writes
+		std::vector< char > buffer( 1 << 20 );
+		std::size_t filled = 0;
+		const bool fiducials = extension == ".fcsv";
+		if( fiducials )
+		{
+			filled = std::sprintf( &buffer[0], "# Markups fiducial file version = 4.6\n# CoordinateSystem = 0\n"
+				"# columns = id,x,y,z,ow,ox,oy,oz,vis,sel,lock,label,desc,associatedNodeID\n" );
+		}
+		else
+		{
+			filled = std::sprintf( &buffer[0], "x,y,z\n" );
+		}
+
+		for( itk::SizeValueType i = 0; i < numberOfPoints && written; ++i )
+		{
+			const double * point = &points[3*i];
+			if( fiducials ) // negate first two components for LPS->RAS
+			{
+				filled += std::sprintf( &buffer[filled], "vtkMRMLMarkupsFiducialNode_%lu,%.9g,%.9g,%.9g,0,0,0,1,1,1,0,F-%lu,,\n",
+					static_cast< unsigned long >( i ), -point[0], -point[1], point[2], static_cast< unsigned long >( i + 1 ) );
+			}
+			else
+			{
+				filled += std::sprintf( &buffer[filled], "%.9g,%.9g,%.9g\n", point[0], point[1], point[2] );
+			}
+
+			// flush well before the buffer could overflow (a line is shorter than 256 characters)
+			if( filled > buffer.size() - 256 )
+			{
+				written = std::fwrite( &buffer[0], 1, filled, file ) == filled;
+				filled = 0;
+			}
+		}
+		written = written && std::fwrite( &buffer[0], 1, filled, file ) == filled;
+	}
+
+	if( std::fclose( file ) != 0 || !written )
+	{
+		std::cerr << "Could not write " << pointSetFilename << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
 // Write a function to read in a transform
 template<typename TransformType>
 typename TransformType::Pointer ReadInTransform( const char * transformFilename)
@@ -212,4 +966,58 @@ int WriteOutTransform( const char * transformFilename, typename TransformType::P
 	
 	// return output
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+
+// Write a function to write out debug images (.nrrd is gzip compressed on all threads, other formats are written as usual)
+template<typename inputImageType, typename outputImageType>
+int WriteOutCompressedImage( const char * ImageFilename, typename inputImageType::Pointer image )
+{
+	const std::string extension = itksys::SystemTools::LowerCase( itksys::SystemTools::GetFilenameLastExtension( ImageFilename ) );
+	if( extension != ".nrrd" || outputImageType::ImageDimension != 3 )
+	{
+		return WriteOutImage<inputImageType, outputImageType>( ImageFilename, image );
+	}
+
+	typedef typename std::is_same<inputImageType, outputImageType>::type SameTypeType;
+	itk::ProcessObject::Pointer caster;
+	typename outputImageType::Pointer output = ImageForWriting<inputImageType, outputImageType>( image, caster, SameTypeType() );
+
+	typedef itk::ParallelCompressedImageWriter<outputImageType> CompressedWriterType;
+	typename CompressedWriterType::Pointer compressedWriter = CompressedWriterType::New();
+	compressedWriter->SetFileName( ImageFilename );
+
+	// update the writer (the slabs are compressed from a whole buffer, so a cast is run in full)
+	try
+	{
+		output->Update();
+		compressedWriter->SetInput( output );
+		compressedWriter->Update();
+	}
+	catch(itk::ExceptionObject & err)
+	{
+		std::cerr << "Exception Object Caught!" << std::endl;
+		std::cerr << err << std::endl;
+		std::cerr << std::endl;
+	}
+
+	// return output
+	return EXIT_SUCCESS;
+}
+
+// Write a function to queue an image write on the background writer (the job keeps a reference to the image)
+// messages of the write go to the log of the calling thread
+template<typename inputImageType, typename outputImageType>
+void WriteOutImageInBackground( itk::BackgroundWriter * writer, const char * ImageFilename, typename inputImageType::Pointer image )
+{
+	const std::string filename( ImageFilename );
+	writer->Enqueue( itk::BatchScheduler::WithThreadLog( [filename, image]() { WriteOutCompressedImage< inputImageType, outputImageType >( filename.c_str(), image ); } ) );
+}
+
+// Write a function to queue a transform write on the background writer (a copy is written so later changes are not seen)
+template<typename TransformType>
+void WriteOutTransformInBackground( itk::BackgroundWriter * writer, const char * transformFilename, typename TransformType::Pointer transform )
+{
+	const std::string filename( transformFilename );
+	typename TransformType::Pointer snapshot = transform->Clone();
+	writer->Enqueue( itk::BatchScheduler::WithThreadLog( [filename, snapshot]() { WriteOutTransform< TransformType >( filename.c_str(), snapshot ); } ) );
+}
@@ -1,4 +1,5 @@
 #include "itkVersorTransformOptimizer.h"
+#include "itkTransformHistoryLog.h"
 
 class RigidCommandIterationUpdate: public itk::Command
 {
@@ -12,19 +13,21 @@ protected:
 		m_observe(false),
 		m_debug(false),
 		m_DebugDirectory(""),
-		stepSize(0)
+		m_History(itk::TransformHistoryLog::New())
 	{
 		std::cout << "\nObserver initialized\n" << std::endl;
 	};
 	bool m_observe;
 	bool m_debug;
-	float stepSize;
 	std::string m_DebugDirectory;
+	itk::TransformHistoryLog::Pointer m_History;
+	itk::TransformHistoryLog::ParametersType m_FixedParameters;
 public:
 	typedef itk::VersorTransformOptimizer				OptimizerType;
 	typedef const OptimizerType *						OptimizerPointer;
 	void Observe() { this->m_observe = true; }
 	void Debug(std::string debugDirectory) { this->m_debug = true; this->m_DebugDirectory = debugDirectory; }
+	void SetFixedParameters(const itk::TransformHistoryLog::ParametersType & fixedParameters) { this->m_FixedParameters = fixedParameters; }
 	void Execute( itk::Object *caller, const itk::EventObject &event )
 	{
 		Execute( (const itk::Object *)caller, event);
@@ -42,15 +45,25 @@ public:
 			std::cout << " " << optimizer->GetValue() << " " << optimizer->GetCurrentPosition();
 			std::cout << std::endl;
 		}
-		float diff = optimizer->GetCurrentStepLength() - stepSize;
-		if ((abs(diff)>0.0001) && this->m_debug)
+		// every iteration is appended to the history of the level (see extractTransformHistory)
+		if (this->m_debug)
 		{
-			std::string filename = this->m_DebugDirectory + "Transform_" + std::to_string(optimizer->GetCurrentIteration()) + ".tfm";
-			itk::ScaleVersor3DTransform< double >::Pointer transform = itk::ScaleVersor3DTransform< double >::New();
-			transform->SetParameters( optimizer->GetCurrentPosition() );
-
-			WriteOutTransform< itk::ScaleVersor3DTransform< double >>(filename.c_str(), transform);
+			if (!this->m_History->IsOpen())
+			{
+				std::string filename = this->m_DebugDirectory + "TransformHistory.bin";
+				try
+				{
+					this->m_History->Open(filename, optimizer->GetCurrentPosition().Size(), this->m_FixedParameters);
+				}
+				catch (itk::ExceptionObject & err)
+				{
+					std::cerr << "Exception Object Caught!" << std::endl;
+					std::cerr << err << std::endl;
+					this->m_debug = false;
+					return;
+				}
+			}
+			this->m_History->Append(optimizer->GetCurrentIteration(), optimizer->GetCurrentStepLength(), optimizer->GetValue(), optimizer->GetCurrentPosition());
 		}
-		stepSize = optimizer->GetCurrentStepLength();
 	}
 };
\ No newline at end of file
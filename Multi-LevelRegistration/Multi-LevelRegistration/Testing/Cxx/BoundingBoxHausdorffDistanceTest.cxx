@@ -0,0 +1,144 @@
+/*
+Purpose: Compare the BoundingBoxHausdorffDistanceFilter with HausdorffDistanceImageFilter run on
+the whole volume for every label of a synthetic pair of label maps: shifted boxes, a ball whose
+counterpart has a hole, a label split into two components, and a label missing from one map.
+
+*/
+
+#include "itkBoundingBoxHausdorffDistanceFilter.h"
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkHausdorffDistanceImageFilter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include <cmath>
+#include <iostream>
+
+typedef itk::Image< unsigned char, 3 >	LabelMapType;
+
+// label of a voxel in the first (second = false) or second label map
+unsigned char SyntheticLabel( const LabelMapType::IndexType & index, bool second )
+{
+	const long x = index[0];
+	const long y = index[1];
+	const long z = index[2];
+
+	// 1: box, shifted by (3, -2, 1) in the second map
+	const long shift[3] = { second ? 3 : 0, second ? -2 : 0, second ? 1 : 0 };
+	if( x >= 4 + shift[0] && x < 12 + shift[0] && y >= 6 + shift[1] && y < 14 + shift[1] && z >= 3 + shift[2] && z < 9 + shift[2] )
+	{
+		return 1;
+	}
+
+	// 2: ball, hollow in the second map
+	const double r2 = ( x - 28.0 )*( x - 28.0 ) + ( y - 20.0 )*( y - 20.0 ) + ( z - 12.0 )*( z - 12.0 );
+	if( r2 <= 49.0 && ( !second || r2 > 9.0 ) )
+	{
+		return 2;
+	}
+
+	// 3: one slab in the first map, two separate slabs in the second
+	if( y >= 30 && y < 34 && z >= 4 && z < 8 && ( second ? ( ( x >= 2 && x < 8 ) || ( x >= 20 && x < 26 ) ) : ( x >= 2 && x < 14 ) ) )
+	{
+		return 3;
+	}
+
+	// 4: only in the first map
+	if( !second && x >= 36 && x < 40 && y >= 2 && y < 6 && z >= 14 && z < 18 )
+	{
+		return 4;
+	}
+
+	return 0;
+}
+
+LabelMapType::Pointer CreateLabelMap( bool second )
+{
+	LabelMapType::SizeType size;
+	size[0] = 42;
+	size[1] = 38;
+	size[2] = 22;
+	LabelMapType::SpacingType spacing;
+	spacing[0] = 0.8;
+	spacing[1] = 1.0;
+	spacing[2] = 2.5;
+
+	LabelMapType::Pointer labelMap = LabelMapType::New();
+	labelMap->SetRegions( LabelMapType::RegionType( size ) );
+	labelMap->SetSpacing( spacing );
+	labelMap->Allocate();
+
+	itk::ImageRegionIteratorWithIndex< LabelMapType > it( labelMap, labelMap->GetBufferedRegion() );
+	for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+	{
+		it.Set( SyntheticLabel( it.GetIndex(), second ) );
+	}
+	return labelMap;
+}
+
+// binary image of one label
+LabelMapType::Pointer IsolateLabel( LabelMapType::Pointer labelMap, unsigned char label )
+{
+	typedef itk::BinaryThresholdImageFilter< LabelMapType, LabelMapType >	ThresholdType;
+	ThresholdType::Pointer threshold = ThresholdType::New();
+	threshold->SetInput( labelMap );
+	threshold->SetLowerThreshold( label );
+	threshold->SetUpperThreshold( label );
+	threshold->SetInsideValue( 1 );
+	threshold->SetOutsideValue( 0 );
+	threshold->Update();
+	return threshold->GetOutput();
+}
+
+int BoundingBoxHausdorffDistanceTest( int, char * [] )
+{
+	LabelMapType::Pointer labelMap1 = CreateLabelMap( false );
+	LabelMapType::Pointer labelMap2 = CreateLabelMap( true );
+
+	typedef itk::BoundingBoxHausdorffDistanceFilter< LabelMapType >	BoundingBoxFilterType;
+	BoundingBoxFilterType::Pointer boundingBox = BoundingBoxFilterType::New();
+	boundingBox->SetInput1( labelMap1 );
+	boundingBox->SetInput2( labelMap2 );
+
+	try
+	{
+		boundingBox->Update();
+	}
+	catch(itk::ExceptionObject & err)
+	{
+		std::cerr << "Exception Object Caught!" << std::endl;
+		std::cerr << err << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	bool passed = true;
+	for( unsigned char label = 1; label <= 3; ++label )
+	{
+		typedef itk::HausdorffDistanceImageFilter< LabelMapType, LabelMapType >	HausdorffFilterType;
+		HausdorffFilterType::Pointer hausdorff = HausdorffFilterType::New();
+		hausdorff->SetInput1( IsolateLabel( labelMap1, label ) );
+		hausdorff->SetInput2( IsolateLabel( labelMap2, label ) );
+		hausdorff->UseImageSpacingOn();
+		hausdorff->Update();
+
+		const double expected = hausdorff->GetHausdorffDistance();
+		const double expectedAverage = hausdorff->GetAverageHausdorffDistance();
+		std::cout << "Label " << static_cast< int >( label ) << ": " << boundingBox->GetHausdorffDistance( label ) << " (" << expected << "), "
+			<< boundingBox->GetAverageHausdorffDistance( label ) << " (" << expectedAverage << ")" << std::endl;
+		if( !boundingBox->HasLabel( label ) ||
+			std::abs( boundingBox->GetHausdorffDistance( label ) - expected ) > 1e-4 ||
+			std::abs( boundingBox->GetAverageHausdorffDistance( label ) - expectedAverage ) > 1e-4 )
+		{
+			std::cerr << "Label " << static_cast< int >( label ) << " differs from HausdorffDistanceImageFilter" << std::endl;
+			passed = false;
+		}
+	}
+
+	// a label missing from one map is reported as -1
+	if( !boundingBox->HasLabel( 4 ) || boundingBox->GetHausdorffDistance( 4 ) != -1 || boundingBox->GetAverageHausdorffDistance( 4 ) != -1 )
+	{
+		std::cerr << "Label 4 is missing from the second label map and should be -1" << std::endl;
+		passed = false;
+	}
+
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,233 @@
+/*
+Purpose: Compare the LinearTransformResampleImageFilter with ResampleImageFilter for an affine
+transform and a composite transform that is collapsed to one matrix, with linear and nearest
+neighbor interpolation, including voxels that map outside the input and voxels that map exactly
+onto the -0.5 and size-0.5 edges of the buffer.
+
+*/
+
+#include "itkLinearTransformResampleImageFilter.h"
+#include "itkAffineTransform.h"
+#include "itkScaleVersor3DTransform.h"
+#include "itkResampleImageFilter.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <cmath>
+#include <iostream>
+
+typedef itk::Image< float, 3 >	ResampleImageType;
+
+// image with smoothly varying values (never equal to the default pixel value)
+ResampleImageType::Pointer CreateResampleImage( const ResampleImageType::SizeType & size, const ResampleImageType::SpacingType & spacing,
+	const ResampleImageType::PointType & origin, const ResampleImageType::DirectionType & direction )
+{
+	ResampleImageType::Pointer image = ResampleImageType::New();
+	image->SetRegions( ResampleImageType::RegionType( size ) );
+	image->SetSpacing( spacing );
+	image->SetOrigin( origin );
+	image->SetDirection( direction );
+	image->Allocate();
+
+	itk::ImageRegionIteratorWithIndex< ResampleImageType > it( image, image->GetBufferedRegion() );
+	for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+	{
+		const ResampleImageType::IndexType index = it.GetIndex();
+		it.Set( static_cast< float >( 100.0 + 10.0*std::sin( 0.7*index[0] ) + 7.0*std::cos( 0.5*index[1] ) + 0.3*index[2]*index[2] ) );
+	}
+	return image;
+}
+
+// resample with both filters and compare every voxel (outside is the number of voxels set to the default value)
+bool CompareResample( const std::string & name, ResampleImageType::Pointer input, ResampleImageType::Pointer reference,
+	const itk::Transform< double, 3, 3 > * transform, bool nearestNeighbor, double tolerance, itk::SizeValueType & outside )
+{
+	const float defaultValue = -1.0f;
+
+	typedef itk::LinearTransformResampleImageFilter< ResampleImageType >	LinearResampleType;
+	LinearResampleType::Pointer linear = LinearResampleType::New();
+	linear->SetReferenceImage( reference );
+	linear->SetInput( input );
+	linear->SetTransform( transform );
+	linear->SetDefaultPixelValue( defaultValue );
+	if( nearestNeighbor )
+	{
+		linear->NearestNeighborInterpolateOn();
+	}
+
+	typedef itk::ResampleImageFilter< ResampleImageType, ResampleImageType >	ResampleType;
+	ResampleType::Pointer resample = ResampleType::New();
+	resample->SetOutputParametersFromImage( reference );
+	resample->SetInput( input );
+	resample->SetTransform( transform );
+	resample->SetDefaultPixelValue( defaultValue );
+	if( nearestNeighbor )
+	{
+		resample->SetInterpolator( itk::NearestNeighborInterpolateImageFunction< ResampleImageType, double >::New() );
+	}
+	else
+	{
+		resample->SetInterpolator( itk::LinearInterpolateImageFunction< ResampleImageType, double >::New() );
+	}
+
+	try
+	{
+		linear->Update();
+		resample->Update();
+	}
+	catch(itk::ExceptionObject & err)
+	{
+		std::cerr << "Exception Object Caught!" << std::endl;
+		std::cerr << err << std::endl;
+		return false;
+	}
+
+	outside = 0;
+	itk::ImageRegionConstIteratorWithIndex< ResampleImageType > expected( resample->GetOutput(), resample->GetOutput()->GetBufferedRegion() );
+	itk::ImageRegionConstIteratorWithIndex< ResampleImageType > actual( linear->GetOutput(), linear->GetOutput()->GetBufferedRegion() );
+	for( expected.GoToBegin(), actual.GoToBegin(); !expected.IsAtEnd(); ++expected, ++actual )
+	{
+		if( std::abs( expected.Get() - actual.Get() ) > tolerance )
+		{
+			std::cerr << name << ": voxel " << expected.GetIndex() << " is " << actual.Get() << ", " << expected.Get() << " expected" << std::endl;
+			return false;
+		}
+		outside += expected.Get() == defaultValue ? 1 : 0;
+	}
+
+	std::cout << name << ": " << outside << " voxels outside the input" << std::endl;
+	return true;
+}
+
+int LinearTransformResampleTest( int, char * [] )
+{
+	bool passed = true;
+	itk::SizeValueType outside = 0;
+
+	// oblique, anisotropic input
+	ResampleImageType::SizeType size;
+	size[0] = 14;
+	size[1] = 11;
+	size[2] = 9;
+	ResampleImageType::SpacingType spacing;
+	spacing[0] = 1.2;
+	spacing[1] = 0.9;
+	spacing[2] = 1.5;
+	ResampleImageType::PointType origin;
+	origin[0] = -3.0;
+	origin[1] = 2.0;
+	origin[2] = 5.0;
+	ResampleImageType::DirectionType direction;
+	direction.SetIdentity();
+	const double angle = 0.35;
+	direction[0][0] = std::cos( angle );
+	direction[0][1] = -std::sin( angle );
+	direction[1][0] = std::sin( angle );
+	direction[1][1] = std::cos( angle );
+	ResampleImageType::Pointer input = CreateResampleImage( size, spacing, origin, direction );
+
+	// reference grid larger than the input, so some voxels map outside
+	ResampleImageType::SizeType referenceSize;
+	referenceSize[0] = 18;
+	referenceSize[1] = 15;
+	referenceSize[2] = 12;
+	ResampleImageType::SpacingType referenceSpacing;
+	referenceSpacing.Fill( 1.0 );
+	ResampleImageType::PointType referenceOrigin;
+	referenceOrigin[0] = -8.0;
+	referenceOrigin[1] = -1.0;
+	referenceOrigin[2] = 2.0;
+	ResampleImageType::DirectionType identity;
+	identity.SetIdentity();
+	ResampleImageType::Pointer reference = CreateResampleImage( referenceSize, referenceSpacing, referenceOrigin, identity );
+
+	// affine transform with rotation, scaling and shear
+	typedef itk::AffineTransform< double, 3 >	AffineTransformType;
+	AffineTransformType::Pointer affine = AffineTransformType::New();
+	AffineTransformType::MatrixType matrix;
+	matrix[0][0] = 0.95;	matrix[0][1] = 0.12;	matrix[0][2] = -0.05;
+	matrix[1][0] = -0.1;	matrix[1][1] = 1.07;	matrix[1][2] = 0.08;
+	matrix[2][0] = 0.03;	matrix[2][1] = -0.06;	matrix[2][2] = 0.98;
+	affine->SetMatrix( matrix );
+	AffineTransformType::OutputVectorType translation;
+	translation[0] = 1.3;
+	translation[1] = -0.7;
+	translation[2] = 2.1;
+	affine->SetTranslation( translation );
+	AffineTransformType::InputPointType center;
+	center[0] = 2.0;
+	center[1] = 6.0;
+	center[2] = 11.0;
+	affine->SetCenter( center );
+
+	passed = CompareResample( "Affine, linear", input, reference, affine, false, 1e-3, outside ) && outside > 0 && passed;
+	passed = CompareResample( "Affine, nearest neighbor", input, reference, affine, true, 0.0, outside ) && outside > 0 && passed;
+
+	// composite of a scale versor and the affine transform (collapsed to one matrix by the filter)
+	typedef itk::ScaleVersor3DTransform< double >	ScaleVersorTransformType;
+	ScaleVersorTransformType::Pointer scaleVersor = ScaleVersorTransformType::New();
+	ScaleVersorTransformType::VersorType versor;
+	ScaleVersorTransformType::VersorType::VectorType axis;
+	axis[0] = 0.2;
+	axis[1] = -0.4;
+	axis[2] = 1.0;
+	versor.Set( axis, 0.15 );
+	scaleVersor->SetCenter( center );
+	scaleVersor->SetRotation( versor );
+	ScaleVersorTransformType::ScaleVectorType scale;
+	scale[0] = 1.05;
+	scale[1] = 0.97;
+	scale[2] = 1.02;
+	scaleVersor->SetScale( scale );
+	ScaleVersorTransformType::OutputVectorType scaleVersorTranslation;
+	scaleVersorTranslation[0] = -0.6;
+	scaleVersorTranslation[1] = 0.4;
+	scaleVersorTranslation[2] = -1.1;
+	scaleVersor->SetTranslation( scaleVersorTranslation );
+
+	typedef itk::CompositeTransform< double, 3 >	CompositeTransformType;
+	CompositeTransformType::Pointer composite = CompositeTransformType::New();
+	composite->AddTransform( scaleVersor );
+	composite->AddTransform( affine );
+
+	// make sure the composite is resampled by the filter itself and not by the fallback
+	typedef itk::LinearTransformResampleImageFilter< ResampleImageType >	LinearResampleType;
+	LinearResampleType::MatrixType collapsedMatrix;
+	LinearResampleType::OffsetType collapsedOffset;
+	if( !LinearResampleType::CollapseTransform( composite, collapsedMatrix, collapsedOffset ) )
+	{
+		std::cerr << "Composite transform was not collapsed" << std::endl;
+		passed = false;
+	}
+
+	passed = CompareResample( "Composite, linear", input, reference, composite, false, 1e-3, outside ) && outside > 0 && passed;
+	passed = CompareResample( "Composite, nearest neighbor", input, reference, composite, true, 0.0, outside ) && outside > 0 && passed;
+
+	// voxels on the edges: with unit spacing and a half voxel shift, x maps onto -0.5 ... size-1.5
+	// (inside) and y onto 0.5 ... size-0.5 (the last row is outside)
+	ResampleImageType::SpacingType unitSpacing;
+	unitSpacing.Fill( 1.0 );
+	ResampleImageType::PointType zeroOrigin;
+	zeroOrigin.Fill( 0.0 );
+	ResampleImageType::Pointer edgeInput = CreateResampleImage( size, unitSpacing, zeroOrigin, identity );
+
+	AffineTransformType::Pointer shift = AffineTransformType::New();
+	AffineTransformType::OutputVectorType halfVoxel;
+	halfVoxel[0] = -0.5;
+	halfVoxel[1] = 0.5;
+	halfVoxel[2] = 0.0;
+	shift->SetTranslation( halfVoxel );
+
+	const itk::SizeValueType lastRow = size[0]*size[2];
+	passed = CompareResample( "Edges, linear", edgeInput, edgeInput, shift, false, 1e-3, outside ) && outside == lastRow && passed;
+	passed = CompareResample( "Edges, nearest neighbor", edgeInput, edgeInput, shift, true, 0.0, outside ) && outside == lastRow && passed;
+
+	if( !passed )
+	{
+		std::cerr << "LinearTransformResampleImageFilter differs from ResampleImageFilter" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+/*
+Purpose: Read attached raw NRRD files with ReadInImage. A header of even length is mapped; a header of
+odd length would misalign the pixels, so the file is read with ImageFileReader instead. Both must give
+the written pixels.
+
+*/
+
+#include "ReadWriteFunctions.hxx"
+
+#include <fstream>
+#include <iostream>
+
+// write an attached raw NRRD whose header is padded with a comment to the given parity
+bool WriteAttachedNrrd( const std::string & filename, bool oddHeader, const std::vector< short > & pixels )
+{
+	std::string header = "NRRD0004\ntype: short\ndimension: 3\nspace: left-posterior-superior\nsizes: 5 4 3\n"
+		"space directions: (1,0,0) (0,1,0) (0,0,2)\nkinds: domain domain domain\n";
+	header += std::string( "endian: " ) + ( itk::ByteSwapper< short >::SystemIsBigEndian() ? "big" : "little" ) + "\n";
+	header += "encoding: raw\nspace origin: (0,0,0)\n";
+	std::string padding = "# padding\n";
+	if( ( header.size() + padding.size() + 1 ) % 2 != ( oddHeader ? 1u : 0u ) )
+	{
+		padding = "# padding.\n";
+	}
+	header += padding + "\n";
+
+	std::ofstream file( filename.c_str(), std::ios::out | std::ios::binary );
+	file.write( header.c_str(), header.size() );
+	file.write( reinterpret_cast< const char * >( &pixels[0] ), pixels.size()*sizeof( short ) );
+	file.close();
+	return !file.fail() && ( header.size() % 2 == 1 ) == oddHeader;
+}
+
+int MappedImageReadTest( int argc, char * argv[] )
+{
+	if( argc < 2 )
+	{
+		std::cerr << "Usage: " << argv[0] << " outputDirectory" << std::endl;
+		return EXIT_FAILURE;
+	}
+	const std::string directory = std::string( argv[1] ) + "/";
+
+	typedef itk::Image< short, 3 > ImageType;
+	std::vector< short > pixels( 5*4*3 );
+	for( std::size_t i = 0; i < pixels.size(); ++i )
+	{
+		pixels[i] = static_cast< short >( 37*i - 1000 );
+	}
+
+	bool passed = true;
+	for( unsigned int odd = 0; odd < 2; ++odd )
+	{
+		const std::string filename = directory + ( odd ? "MappedImageReadTestOdd.nrrd" : "MappedImageReadTestEven.nrrd" );
+		if( !WriteAttachedNrrd( filename, odd == 1, pixels ) )
+		{
+			std::cerr << "Could not write " << filename << std::endl;
+			passed = false;
+			continue;
+		}
+
+		// only the aligned file is mapped
+		ImageType::Pointer mapped = ReadInImageMapped< ImageType >( filename.c_str() );
+		if( odd ? mapped.IsNotNull() : mapped.IsNull() )
+		{
+			std::cerr << filename << ( odd ? " was mapped with misaligned pixels" : " was not mapped" ) << std::endl;
+			passed = false;
+		}
+
+		ImageType::Pointer image = ReadInImage< ImageType >( filename.c_str() );
+		if( image.IsNull() || image->GetBufferedRegion().GetNumberOfPixels() != pixels.size() )
+		{
+			std::cerr << filename << " was not read" << std::endl;
+			passed = false;
+			continue;
+		}
+		const short * buffer = image->GetBufferPointer();
+		if( reinterpret_cast< std::size_t >( buffer ) % sizeof( short ) != 0 )
+		{
+			std::cerr << filename << ": misaligned pixel buffer" << std::endl;
+			passed = false;
+		}
+		for( std::size_t i = 0; i < pixels.size(); ++i )
+		{
+			if( buffer[i] != pixels[i] )
+			{
+				std::cerr << filename << ": pixel " << i << " is " << buffer[i] << ", " << pixels[i] << " expected" << std::endl;
+				passed = false;
+				break;
+			}
+		}
+		if( image->GetSpacing()[2] != 2.0 )
+		{
+			std::cerr << filename << ": spacing " << image->GetSpacing() << std::endl;
+			passed = false;
+		}
+	}
+
+	if( !passed )
+	{
+		return EXIT_FAILURE;
+	}
+	std::cout << "Attached NRRD files read back unchanged." << std::endl;
+	return EXIT_SUCCESS;
+}
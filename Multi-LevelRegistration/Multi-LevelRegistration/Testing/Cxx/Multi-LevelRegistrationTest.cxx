@@ -18,8 +18,18 @@
 #endif
 
 extern "C" MODULE_IMPORT int ModuleEntryPoint(int, char* []);
+int ParallelCompressedImageWriterTest(int, char* []);
+int PointSetReadWriteTest(int, char* []);
+int MappedImageReadTest(int, char* []);
+int BoundingBoxHausdorffDistanceTest(int, char* []);
+int LinearTransformResampleTest(int, char* []);
 
 void RegisterTests()
 {
   StringToTestFunctionMap["ModuleEntryPoint"] = ModuleEntryPoint;
+  StringToTestFunctionMap["ParallelCompressedImageWriterTest"] = ParallelCompressedImageWriterTest;
+  StringToTestFunctionMap["PointSetReadWriteTest"] = PointSetReadWriteTest;
+  StringToTestFunctionMap["MappedImageReadTest"] = MappedImageReadTest;
+  StringToTestFunctionMap["BoundingBoxHausdorffDistanceTest"] = BoundingBoxHausdorffDistanceTest;
+  StringToTestFunctionMap["LinearTransformResampleTest"] = LinearTransformResampleTest;
 }
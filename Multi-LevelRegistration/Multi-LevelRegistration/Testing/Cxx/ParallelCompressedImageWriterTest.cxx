@@ -0,0 +1,127 @@
+/*
+Purpose: Write an image with the ParallelCompressedImageWriter (several gzip members) and check that
+ITK reads back the same pixels and geometry.
+
+*/
+
+#include "itkParallelCompressedImageWriter.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+
+#include <cmath>
+#include <iostream>
+
+int ParallelCompressedImageWriterTest( int argc, char * argv[] )
+{
+	if( argc < 2 )
+	{
+		std::cerr << "Usage: " << argv[0] << " outputImage.nrrd" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	typedef itk::Image< short, 3 > ImageType;
+
+	// odd sized image so the last slab is partial
+	ImageType::SizeType size;
+	size[0] = 13;
+	size[1] = 7;
+	size[2] = 11;
+	ImageType::RegionType region;
+	region.SetSize( size );
+
+	ImageType::SpacingType spacing;
+	spacing[0] = 0.5;
+	spacing[1] = 0.75;
+	spacing[2] = 2.5;
+
+	ImageType::PointType origin;
+	origin[0] = -12.5;
+	origin[1] = 3.25;
+	origin[2] = 40.0;
+
+	// permuted and flipped axes
+	ImageType::DirectionType direction;
+	direction.Fill( 0.0 );
+	direction[0][1] = 1.0;
+	direction[1][0] = -1.0;
+	direction[2][2] = 1.0;
+
+	ImageType::Pointer image = ImageType::New();
+	image->SetRegions( region );
+	image->SetSpacing( spacing );
+	image->SetOrigin( origin );
+	image->SetDirection( direction );
+	image->Allocate();
+
+	itk::ImageRegionIterator< ImageType > it( image, region );
+	short value = -500;
+	for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+	{
+		it.Set( value );
+		value += 7;
+	}
+
+	// one slice per slab writes one gzip member per slice
+	typedef itk::ParallelCompressedImageWriter< ImageType > WriterType;
+	WriterType::Pointer writer = WriterType::New();
+	writer->SetInput( image );
+	writer->SetFileName( argv[1] );
+	writer->SetSlicesPerSlab( 1 );
+
+	typedef itk::ImageFileReader< ImageType > ReaderType;
+	ReaderType::Pointer reader = ReaderType::New();
+	reader->SetFileName( argv[1] );
+
+	try
+	{
+		writer->Update();
+		reader->Update();
+	}
+	catch(itk::ExceptionObject & err)
+	{
+		std::cerr << "Exception Object Caught!" << std::endl;
+		std::cerr << err << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	ImageType::Pointer output = reader->GetOutput();
+
+	// compare geometry
+	if( output->GetLargestPossibleRegion().GetSize() != size )
+	{
+		std::cerr << "Size mismatch: " << output->GetLargestPossibleRegion().GetSize() << std::endl;
+		return EXIT_FAILURE;
+	}
+	for( unsigned int i = 0; i < 3; ++i )
+	{
+		if( std::abs( output->GetSpacing()[i] - spacing[i] ) > 1e-6 || std::abs( output->GetOrigin()[i] - origin[i] ) > 1e-6 )
+		{
+			std::cerr << "Spacing or origin mismatch: " << output->GetSpacing() << " " << output->GetOrigin() << std::endl;
+			return EXIT_FAILURE;
+		}
+		for( unsigned int j = 0; j < 3; ++j )
+		{
+			if( std::abs( output->GetDirection()[i][j] - direction[i][j] ) > 1e-6 )
+			{
+				std::cerr << "Direction mismatch: " << std::endl << output->GetDirection() << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	// compare pixels
+	itk::ImageRegionConstIterator< ImageType > expected( image, region );
+	itk::ImageRegionConstIterator< ImageType > actual( output, output->GetLargestPossibleRegion() );
+	for( expected.GoToBegin(), actual.GoToBegin(); !expected.IsAtEnd(); ++expected, ++actual )
+	{
+		if( expected.Get() != actual.Get() )
+		{
+			std::cerr << "Pixel mismatch at " << expected.GetIndex() << ": " << actual.Get() << " != " << expected.Get() << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::cout << "Compressed image read back unchanged." << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+/*
+Purpose: Write point sets as .fcsv, .csv and binary .bpts and read them back, and read hand written
+fiducial files in RAS and LPS whose last line has no newline.
+
+*/
+
+#include "ReadWriteFunctions.hxx"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+// compare a point set with the expected LPS coordinates
+bool ComparePoints( const std::string & filename, const std::vector< double > & points, const std::vector< double > & expected, double tolerance )
+{
+	if( points.size() != expected.size() )
+	{
+		std::cerr << filename << ": " << points.size()/3 << " points read, " << expected.size()/3 << " expected" << std::endl;
+		return false;
+	}
+	for( std::size_t i = 0; i < points.size(); ++i )
+	{
+		if( std::abs( points[i] - expected[i] ) > tolerance )
+		{
+			std::cerr << filename << ": coordinate " << i << " is " << points[i] << ", " << expected[i] << " expected" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// write text without a newline at the end of the last line
+bool WriteText( const std::string & filename, const char * text )
+{
+	std::ofstream file( filename.c_str(), std::ios::out | std::ios::binary );
+	file << text;
+	file.close();
+	return !file.fail();
+}
+
+int PointSetReadWriteTest( int argc, char * argv[] )
+{
+	if( argc < 2 )
+	{
+		std::cerr << "Usage: " << argv[0] << " outputDirectory" << std::endl;
+		return EXIT_FAILURE;
+	}
+	const std::string directory = std::string( argv[1] ) + "/";
+	bool passed = true;
+
+	// points in LPS
+	std::vector< double > points;
+	for( unsigned int i = 0; i < 1000; ++i )
+	{
+		points.push_back( 0.125*i - 40.5 );
+		points.push_back( -0.25*i + 12.75 );
+		points.push_back( 1e-3*i*i );
+	}
+
+	// round trip through every format (text is written with 9 significant digits)
+	const char * extensions[3] = { ".fcsv", ".csv", ".bpts" };
+	for( unsigned int e = 0; e < 3; ++e )
+	{
+		const std::string filename = directory + "PointSetReadWriteTest" + extensions[e];
+		std::vector< double > readPoints;
+		if( WriteOutPointSet( filename.c_str(), points ) != EXIT_SUCCESS )
+		{
+			passed = false;
+			continue;
+		}
+		ReadInPointSet( filename.c_str(), readPoints );
+		passed = ComparePoints( filename, readPoints, points, e == 2 ? 0.0 : 1e-6 ) && passed;
+	}
+
+	// the first two components of the expected points are negated for RAS files
+	std::vector< double > expected;
+	expected.push_back( 1.5 );
+	expected.push_back( -2.25 );
+	expected.push_back( 3.0 );
+	expected.push_back( -4.0 );
+	expected.push_back( 5.5 );
+	expected.push_back( 6.75 );
+
+	// Slicer fiducials in RAS, the last line has no newline
+	const std::string rasFilename = directory + "PointSetReadWriteTestRAS.fcsv";
+	passed = WriteText( rasFilename, "# Markups fiducial file version = 4.6\n# CoordinateSystem = 0\n"
+		"# columns = id,x,y,z,ow,ox,oy,oz,vis,sel,lock,label,desc,associatedNodeID\n"
+		"vtkMRMLMarkupsFiducialNode_0,-1.5,2.25,3,0,0,0,1,1,1,0,F-1,,\n"
+		"vtkMRMLMarkupsFiducialNode_1,4,-5.5,6.75,0,0,0,1,1,1,0,F-2,," ) && passed;
+	std::vector< double > readPoints;
+	ReadInPointSet( rasFilename.c_str(), readPoints );
+	passed = ComparePoints( rasFilename, readPoints, expected, 0.0 ) && passed;
+
+	// Slicer fiducials in LPS, the last line has no newline
+	const std::string lpsFilename = directory + "PointSetReadWriteTestLPS.fcsv";
+	passed = WriteText( lpsFilename, "# Markups fiducial file version = 4.11\n# CoordinateSystem = LPS\n"
+		"# columns = id,x,y,z,ow,ox,oy,oz,vis,sel,lock,label,desc,associatedNodeID\n"
+		"1,1.5,-2.25,3,0,0,0,1,1,1,0,F-1,,\n"
+		"2,-4,5.5,6.75,0,0,0,1,1,1,0,F-2,," ) && passed;
+	ReadInPointSet( lpsFilename.c_str(), readPoints );
+	passed = ComparePoints( lpsFilename, readPoints, expected, 0.0 ) && passed;
+
+	// comma separated points with a header line, the last line has no newline
+	const std::string csvFilename = directory + "PointSetReadWriteTestPartial.csv";
+	passed = WriteText( csvFilename, "x,y,z\n1.5,-2.25,3\n-4,5.5,6.75" ) && passed;
+	ReadInPointSet( csvFilename.c_str(), readPoints );
+	passed = ComparePoints( csvFilename, readPoints, expected, 0.0 ) && passed;
+
+	if( !passed )
+	{
+		return EXIT_FAILURE;
+	}
+	std::cout << "Point sets read back unchanged." << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+/*
+Purpose: This class writes files on its own thread so that registration does not wait for disk I/O.
+Write jobs (see WriteOutImageInBackground/WriteOutTransformInBackground in ReadWriteFunctions.hxx)
+hold their own references to the images and transforms and are executed in the order they were
+queued. The queue is bounded: when it is full, the caller waits until a write finishes, which keeps
+the memory held by pending images limited. Flush() waits for all pending writes and is also called
+by the destructor. Report() prints the number of writes, the largest queue depth, the time callers
+waited on a full queue and the write latency (time from queuing to completion).
+
+*/
+
+#ifndef __itkBackgroundWriter_h
+#define __itkBackgroundWriter_h
+
+// include files
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+namespace itk
+{
+// class BackgroundWriter
+class BackgroundWriter: public Object
+{
+public:
+	// default ITK
+	typedef BackgroundWriter			Self;
+	typedef Object						Superclass;
+	typedef SmartPointer< Self >		Pointer;
+	typedef SmartPointer< const Self >	ConstPointer;
+
+	// definitions
+	typedef std::function< void() >				JobType;
+	typedef std::chrono::steady_clock			ClockType;
+
+	// method for creation
+	itkNewMacro(Self);
+
+	// run-time type information and related methods
+	itkTypeMacro(BackgroundWriter, Object);
+
+	// maximum number of pending writes (default 4)
+	void SetMaximumQueueSize( unsigned int size )
+	{
+		std::lock_guard< std::mutex > lock( m_Mutex );
+		m_MaximumQueueSize = std::max( 1u, size );
+	}
+
+	// add a write to the queue (waits while the queue is full)
+	void Enqueue( const JobType & job )
+	{
+		const ClockType::time_point start = ClockType::now();
+		std::unique_lock< std::mutex > lock( m_Mutex );
+		if( !m_Thread.joinable() )
+		{
+			m_Stop = false;
+			m_Thread = std::thread( &Self::Run, this );
+		}
+		m_NotFull.wait( lock, [this]{ return m_Queue.size() < m_MaximumQueueSize; } );
+		m_BlockedTime += std::chrono::duration< double >( ClockType::now() - start ).count();
+
+		m_Queue.push_back( QueuedJob( job, ClockType::now() ) );
+		m_MaximumDepth = std::max( m_MaximumDepth, static_cast< unsigned int >( m_Queue.size() ) );
+		m_NotEmpty.notify_one();
+	}
+
+	// wait until all queued writes are on disk
+	void Flush()
+	{
+		std::unique_lock< std::mutex > lock( m_Mutex );
+		m_Idle.wait( lock, [this]{ return m_Queue.empty() && !m_Writing; } );
+	}
+
+	// print queue and latency statistics
+	void Report( std::ostream & os )
+	{
+		std::lock_guard< std::mutex > lock( m_Mutex );
+		os << "Background writes" << std::endl;
+		os << "  Number of writes  : " << m_NumberOfWrites << std::endl;
+		os << "  Max queue depth   : " << m_MaximumDepth << " (of " << m_MaximumQueueSize << ")" << std::endl;
+		os << "  Caller wait (s)   : " << m_BlockedTime << std::endl;
+		os << "  Mean latency (s)  : " << ( m_NumberOfWrites > 0 ? m_TotalLatency/m_NumberOfWrites : 0.0 ) << std::endl;
+		os << "  Max latency (s)   : " << m_MaximumLatency << std::endl;
+	}
+
+protected:
+	// constructor
+	BackgroundWriter():
+		m_MaximumQueueSize( 4 ),
+		m_Stop( false ),
+		m_Writing( false ),
+		m_NumberOfWrites( 0 ),
+		m_MaximumDepth( 0 ),
+		m_BlockedTime( 0.0 ),
+		m_TotalLatency( 0.0 ),
+		m_MaximumLatency( 0.0 )
+	{}
+
+	// destructor (flushes pending writes)
+	virtual ~BackgroundWriter()
+	{
+		{
+			std::lock_guard< std::mutex > lock( m_Mutex );
+			m_Stop = true;
+		}
+		m_NotEmpty.notify_one();
+		if( m_Thread.joinable() )
+		{
+			m_Thread.join();
+		}
+	}
+
+private:
+	// a write and the time it was queued
+	typedef std::pair< JobType, ClockType::time_point >	QueuedJob;
+
+	// writer thread: runs jobs in order until stopped and the queue is empty
+	void Run()
+	{
+		std::unique_lock< std::mutex > lock( m_Mutex );
+		while( true )
+		{
+			m_NotEmpty.wait( lock, [this]{ return m_Stop || !m_Queue.empty(); } );
+			if( m_Queue.empty() )
+			{
+				return;
+			}
+
+			QueuedJob job = m_Queue.front();
+			m_Queue.pop_front();
+			m_Writing = true;
+			m_NotFull.notify_one();
+
+			// write without holding the lock
+			lock.unlock();
+			job.first();
+			const double latency = std::chrono::duration< double >( ClockType::now() - job.second ).count();
+			lock.lock();
+
+			m_Writing = false;
+			++m_NumberOfWrites;
+			m_TotalLatency += latency;
+			m_MaximumLatency = std::max( m_MaximumLatency, latency );
+			if( m_Queue.empty() )
+			{
+				m_Idle.notify_all();
+			}
+		}
+	}
+
+	// queue
+	std::deque< QueuedJob > m_Queue;
+	unsigned int m_MaximumQueueSize;
+	bool m_Stop;
+	bool m_Writing;
+	std::thread m_Thread;
+	std::mutex m_Mutex;
+	std::condition_variable m_NotEmpty;
+	std::condition_variable m_NotFull;
+	std::condition_variable m_Idle;
+
+	// statistics
+	unsigned int m_NumberOfWrites;
+	unsigned int m_MaximumDepth;
+	double m_BlockedTime;
+	double m_TotalLatency;
+	double m_MaximumLatency;
+};
+} // end namespace
+
+#endif
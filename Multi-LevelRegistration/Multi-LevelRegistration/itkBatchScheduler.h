@@ -0,0 +1,332 @@
+/*
+Purpose: This class runs the jobs of a batch on a fixed number of worker threads within a memory
+budget. Every job comes with an estimate of the memory it needs; a worker starts the first waiting
+job (in the order added) whose estimate fits in what is left of the budget. A job larger than the
+whole budget runs once nothing else is running. While a job runs, everything its thread writes to
+std::cout and std::cerr goes to the job's log file, so the logs of concurrent registrations are not
+interleaved. Threads started by a job write to the same log when their function is wrapped with
+WithThreadLog() on the job's thread.
+
+Results (status, wall time) are kept in the order the jobs were added and are printed by Report().
+
+*/
+
+#ifndef __itkBatchScheduler_h
+#define __itkBatchScheduler_h
+
+// include files
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkMacro.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <utility>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace itk
+{
+// class BatchScheduler
+class BatchScheduler: public Object
+{
+public:
+	// default ITK
+	typedef BatchScheduler				Self;
+	typedef Object						Superclass;
+	typedef SmartPointer< Self >		Pointer;
+	typedef SmartPointer< const Self >	ConstPointer;
+
+	// definitions
+	typedef std::function< int() >		JobType;
+	struct ResultType
+	{
+		std::string name;
+		std::string logFilename;
+		SizeValueType memory;
+		int status;
+		double seconds;
+	};
+
+	// method for creation
+	itkNewMacro(Self);
+
+	// run-time type information and related methods
+	itkTypeMacro(BatchScheduler, Object);
+
+	// number of jobs running at the same time (default 1)
+	itkSetMacro( NumberOfWorkers, unsigned int );
+
+	// memory available to all running jobs in bytes (0: no limit)
+	itkSetMacro( MemoryBudget, SizeValueType );
+
+	// add a job with its memory estimate (bytes) and log file (empty: output stays on the console)
+	void AddJob( const std::string & name, SizeValueType memory, const std::string & logFilename, const JobType & job )
+	{
+		PendingJobType pending;
+		pending.index = static_cast< unsigned int >( m_Results.size() );
+		pending.job = job;
+		m_Pending.push_back( pending );
+
+		ResultType result;
+		result.name = name;
+		result.logFilename = logFilename;
+		result.memory = memory;
+		result.status = EXIT_FAILURE;
+		result.seconds = 0.0;
+		m_Results.push_back( result );
+	}
+
+	// run all jobs and wait for them
+	void Run()
+	{
+		// console output of the jobs is routed to their logs
+		ThreadRoutedBuffer coutBuffer( std::cout.rdbuf() );
+		ThreadRoutedBuffer cerrBuffer( std::cerr.rdbuf() );
+		std::cout.rdbuf( &coutBuffer );
+		std::cerr.rdbuf( &cerrBuffer );
+
+		std::vector< std::thread > workers;
+		for( unsigned int i = 0; i < std::max( 1u, m_NumberOfWorkers ); ++i )
+		{
+			workers.push_back( std::thread( &Self::Work, this ) );
+		}
+		for( unsigned int i = 0; i < workers.size(); ++i )
+		{
+			workers[i].join();
+		}
+
+		std::cout.rdbuf( coutBuffer.GetConsole() );
+		std::cerr.rdbuf( cerrBuffer.GetConsole() );
+	}
+
+	const std::vector< ResultType > & GetResults() const
+	{
+		return m_Results;
+	}
+
+	// log of the calling thread (null: console)
+	static std::streambuf *& ThreadLog()
+	{
+		static thread_local std::streambuf * log = ITK_NULLPTR;
+		return log;
+	}
+
+	// sets the log of the calling thread and restores the previous one when it goes out of scope
+	class ScopedThreadLog
+	{
+	public:
+		ScopedThreadLog( std::streambuf * log ): m_Previous( ThreadLog() ) { ThreadLog() = log; }
+		~ScopedThreadLog() { ThreadLog() = m_Previous; }
+
+	private:
+		ScopedThreadLog( const ScopedThreadLog & );
+		void operator=( const ScopedThreadLog & );
+		std::streambuf * m_Previous;
+	};
+
+	// function that runs with the log of the thread that created it (for std::async and queued jobs)
+	template< typename TFunction >
+	class ThreadLogFunction
+	{
+	public:
+		ThreadLogFunction( const TFunction & function, std::streambuf * log ): m_Function( function ), m_Log( log ) {}
+
+		template< typename... TArguments >
+		auto operator()( TArguments &&... arguments ) -> decltype( std::declval< TFunction & >()( std::forward< TArguments >( arguments )... ) )
+		{
+			ScopedThreadLog scopedLog( m_Log );
+			return m_Function( std::forward< TArguments >( arguments )... );
+		}
+
+	private:
+		TFunction m_Function;
+		std::streambuf * m_Log;
+	};
+
+	// wrap a function so that its output goes to the log of the calling thread wherever it runs
+	template< typename TFunction >
+	static ThreadLogFunction< TFunction > WithThreadLog( TFunction function )
+	{
+		return ThreadLogFunction< TFunction >( function, ThreadLog() );
+	}
+
+	// print a table of the results
+	void Report( std::ostream & os ) const
+	{
+		os << std::left << std::setw( 40 ) << "Job" << std::right << std::setw( 8 ) << "Status"
+			<< std::setw( 12 ) << "Time (s)" << std::setw( 14 ) << "Memory (MB)" << "  Log" << std::endl;
+		for( unsigned int i = 0; i < m_Results.size(); ++i )
+		{
+			os << std::left << std::setw( 40 ) << m_Results[i].name << std::right
+				<< std::setw( 8 ) << ( m_Results[i].status == EXIT_SUCCESS ? "ok" : "failed" )
+				<< std::setw( 12 ) << std::fixed << std::setprecision( 1 ) << m_Results[i].seconds
+				<< std::setw( 14 ) << m_Results[i].memory/( 1024*1024 )
+				<< "  " << m_Results[i].logFilename << std::endl;
+		}
+		os.unsetf( std::ios_base::floatfield );
+		os << std::setprecision( 6 );
+	}
+
+protected:
+	// constructor
+	BatchScheduler():
+		m_NumberOfWorkers( 1 ),
+		m_MemoryBudget( 0 ),
+		m_MemoryInUse( 0 ),
+		m_Running( 0 )
+	{}
+
+	// destructor
+	virtual ~BatchScheduler() {}
+
+private:
+	// stream buffer that sends the output of a thread to that thread's log (or the console)
+	// writes are serialized, since a job and the threads it started share one log
+	class ThreadRoutedBuffer: public std::streambuf
+	{
+	public:
+		ThreadRoutedBuffer( std::streambuf * console ): m_Console( console ) {}
+		std::streambuf * GetConsole() const { return m_Console; }
+
+	protected:
+		virtual int_type overflow( int_type c )
+		{
+			if( traits_type::eq_int_type( c, traits_type::eof() ) )
+			{
+				return traits_type::not_eof( c );
+			}
+			std::lock_guard< std::mutex > lock( WriteMutex() );
+			return this->Target()->sputc( traits_type::to_char_type( c ) );
+		}
+		virtual std::streamsize xsputn( const char * s, std::streamsize n )
+		{
+			std::lock_guard< std::mutex > lock( WriteMutex() );
+			return this->Target()->sputn( s, n );
+		}
+		virtual int sync()
+		{
+			std::lock_guard< std::mutex > lock( WriteMutex() );
+			return this->Target()->pubsync();
+		}
+
+	private:
+		std::streambuf * Target() const
+		{
+			std::streambuf * target = BatchScheduler::ThreadLog();
+			return target ? target : m_Console;
+		}
+		// shared by the std::cout and std::cerr buffers, which write to the same logs
+		static std::mutex & WriteMutex()
+		{
+			static std::mutex mutex;
+			return mutex;
+		}
+		std::streambuf * m_Console;
+	};
+
+	struct PendingJobType
+	{
+		unsigned int index;
+		JobType job;
+	};
+
+	// worker thread: runs jobs that fit in the budget until none are left
+	void Work()
+	{
+		std::unique_lock< std::mutex > lock( m_Mutex );
+		while( true )
+		{
+			std::list< PendingJobType >::iterator next = m_Pending.end();
+			m_Changed.wait( lock, [this, &next]
+			{
+				next = this->NextJob();
+				return m_Pending.empty() || next != m_Pending.end();
+			} );
+			if( m_Pending.empty() )
+			{
+				return;
+			}
+
+			PendingJobType pending = *next;
+			m_Pending.erase( next );
+			const SizeValueType memory = m_Results[pending.index].memory;
+			const std::string logFilename = m_Results[pending.index].logFilename;
+			m_MemoryInUse += memory;
+			++m_Running;
+
+			lock.unlock();
+			int status = EXIT_FAILURE;
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			{
+				std::filebuf log;
+				if( !logFilename.empty() && log.open( logFilename.c_str(), std::ios::out | std::ios::trunc ) )
+				{
+					ThreadLog() = &log;
+				}
+				try
+				{
+					status = pending.job();
+				}
+				catch( ExceptionObject & err )
+				{
+					std::cerr << "Exception Object Caught!" << std::endl;
+					std::cerr << err << std::endl;
+				}
+				catch( std::exception & err )
+				{
+					std::cerr << "Exception caught: " << err.what() << std::endl;
+				}
+				std::cout.flush();
+				std::cerr.flush();
+				ThreadLog() = ITK_NULLPTR;
+			}
+			const double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+			lock.lock();
+
+			m_MemoryInUse -= memory;
+			--m_Running;
+			m_Results[pending.index].status = status;
+			m_Results[pending.index].seconds = seconds;
+			std::cout << m_Results[pending.index].name << ( status == EXIT_SUCCESS ? " finished" : " failed" )
+				<< " (" << m_Pending.size() << " waiting)" << std::endl;
+			m_Changed.notify_all();
+		}
+	}
+
+	// first waiting job that fits in the remaining budget (anything fits when nothing runs)
+	std::list< PendingJobType >::iterator NextJob()
+	{
+		std::list< PendingJobType >::iterator it = m_Pending.begin();
+		for( ; it != m_Pending.end(); ++it )
+		{
+			if( m_MemoryBudget == 0 || m_Running == 0 ||
+				m_MemoryInUse + m_Results[it->index].memory <= m_MemoryBudget )
+			{
+				break;
+			}
+		}
+		return it;
+	}
+
+	unsigned int m_NumberOfWorkers;
+	SizeValueType m_MemoryBudget;
+	SizeValueType m_MemoryInUse;
+	unsigned int m_Running;
+	std::list< PendingJobType > m_Pending;
+	std::vector< ResultType > m_Results;
+	std::mutex m_Mutex;
+	std::condition_variable m_Changed;
+};
+} // end namespace
+
+#endif
@@ -0,0 +1,102 @@
+/*
+Purpose: This class computes the Hausdorff distance and average Hausdorff distance for every
+label shared by two label maps. Each label is processed only inside the padded union of its
+bounding boxes in the two label maps: the label is copied into a binary image of that box, a
+distance map of the box is computed with the (multithreaded) SignedMaurerDistanceMapImageFilter
+and every voxel of the box is scanned. The work therefore scales with the bounding box volume of
+each label (not with its surface), which is still much less than the whole volume for small labels.
+
+The definitions are those of HausdorffDistanceImageFilter: the directed distances are taken over
+all voxels of a label (distance to the other label, 0 inside it); the Hausdorff distance is the
+larger directed maximum and the average Hausdorff distance the mean of the two directed averages.
+
+*/
+
+#ifndef __itkBoundingBoxHausdorffDistanceFilter_h
+#define __itkBoundingBoxHausdorffDistanceFilter_h
+
+// include files
+#include "itkImage.h"
+#include "itkSignedMaurerDistanceMapImageFilter.h"
+
+#include <map>
+
+namespace itk
+{
+// class BoundingBoxHausdorffDistanceFilter
+template< typename TLabelImageType >
+class BoundingBoxHausdorffDistanceFilter: public Object
+{
+public:
+	// default ITK
+	typedef BoundingBoxHausdorffDistanceFilter	Self;
+	typedef Object								Superclass;
+	typedef SmartPointer< Self >				Pointer;
+	typedef SmartPointer< const Self >			ConstPointer;
+
+	// definitions
+	typedef TLabelImageType							LabelImageType;
+	typedef typename LabelImageType::PixelType		LabelType;
+	typedef typename LabelImageType::RegionType		RegionType;
+	typedef typename LabelImageType::IndexType		IndexType;
+	typedef itk::Image< unsigned char, 3 >			BinaryImageType;
+	typedef itk::Image< float, 3 >					DistanceImageType;
+	typedef itk::SignedMaurerDistanceMapImageFilter< BinaryImageType, DistanceImageType >	DistanceFilterType;
+
+	// method for creation
+	itkNewMacro(Self);
+
+	// run-time type information and related methods
+	itkTypeMacro(BoundingBoxHausdorffDistanceFilter, Object);
+
+	// set inputs
+	itkSetConstObjectMacro( Input1, LabelImageType );
+	itkSetConstObjectMacro( Input2, LabelImageType );
+
+	// number of voxels added around the bounding boxes
+	itkSetMacro( Padding, unsigned int );
+
+	// perform function
+	void Update();
+
+	// get results (-1 if the label is missing from one of the label maps)
+	bool HasLabel( LabelType label ) const
+	{
+		return m_HausdorffDistances.find( label ) != m_HausdorffDistances.end();
+	}
+	double GetHausdorffDistance( LabelType label ) const;
+	double GetAverageHausdorffDistance( LabelType label ) const;
+
+protected:
+	// constructor
+	BoundingBoxHausdorffDistanceFilter();
+
+	// destructor
+	virtual ~BoundingBoxHausdorffDistanceFilter() {}
+
+private:
+	// inputs
+	typename LabelImageType::ConstPointer m_Input1;
+	typename LabelImageType::ConstPointer m_Input2;
+	unsigned int m_Padding;
+
+	// results
+	std::map< LabelType, double > m_HausdorffDistances;
+	std::map< LabelType, double > m_AverageHausdorffDistances;
+
+	// bounding boxes stored as [ min index, max index ]
+	typedef std::pair< IndexType, IndexType >	BoundingBoxType;
+	void ComputeBoundingBoxes( const LabelImageType * image, std::map< LabelType, BoundingBoxType > & boxes );
+
+	// distances within a region
+	typename BinaryImageType::Pointer IsolateLabel( const LabelImageType * image, LabelType label, const RegionType & region );
+	typename DistanceImageType::Pointer ComputeDistanceMap( const BinaryImageType * binary );
+	void DirectedDistance( const BinaryImageType * from, const DistanceImageType * distance, double & maximum, double & average );
+};
+} // end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkBoundingBoxHausdorffDistanceFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef __itkBoundingBoxHausdorffDistanceFilter_hxx
+#define __itkBoundingBoxHausdorffDistanceFilter_hxx
+
+#include "itkBoundingBoxHausdorffDistanceFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
+
+namespace itk
+{
+	// constructor
+	template< typename TLabelImageType >
+	BoundingBoxHausdorffDistanceFilter< TLabelImageType >::BoundingBoxHausdorffDistanceFilter():
+		m_Input1( ITK_NULLPTR ),	// defined by user
+		m_Input2( ITK_NULLPTR ),	// defined by user
+		m_Padding( 1 )
+	{}
+
+	template< typename TLabelImageType >
+	void BoundingBoxHausdorffDistanceFilter< TLabelImageType >::Update()
+	{
+		// error checking
+		if( !m_Input1 )
+		{
+			itkExceptionMacro( << "Input1 not present" );
+		}
+		if( !m_Input2 )
+		{
+			itkExceptionMacro( << "Input2 not present" );
+		}
+		if( m_Input1->GetBufferedRegion() != m_Input2->GetBufferedRegion() )
+		{
+			itkExceptionMacro( << "Label maps must occupy the same region" );
+		}
+
+		this->m_HausdorffDistances.clear();
+		this->m_AverageHausdorffDistances.clear();
+
+		// find the extent of every label in one pass per label map
+		std::map< LabelType, BoundingBoxType > boxes1, boxes2;
+		ComputeBoundingBoxes( this->m_Input1, boxes1 );
+		ComputeBoundingBoxes( this->m_Input2, boxes2 );
+
+		// labels present in either label map
+		std::map< LabelType, BoundingBoxType > labels( boxes1 );
+		labels.insert( boxes2.begin(), boxes2.end() );
+
+		const RegionType largestRegion = this->m_Input1->GetBufferedRegion();
+		typename std::map< LabelType, BoundingBoxType >::const_iterator it;
+		for( it = labels.begin(); it != labels.end(); ++it )
+		{
+			const LabelType label = it->first;
+			if( boxes1.find( label ) == boxes1.end() || boxes2.find( label ) == boxes2.end() )
+			{
+				this->m_HausdorffDistances[label] = -1;
+				this->m_AverageHausdorffDistances[label] = -1;
+				continue;
+			}
+
+			// padded union of both bounding boxes
+			const BoundingBoxType & box1 = boxes1[label];
+			const BoundingBoxType & box2 = boxes2[label];
+			IndexType start, end;
+			typename RegionType::SizeType size;
+			for( unsigned int d = 0; d < 3; ++d )
+			{
+				start[d] = std::min( box1.first[d], box2.first[d] ) - static_cast< IndexValueType >( m_Padding );
+				end[d] = std::max( box1.second[d], box2.second[d] ) + static_cast< IndexValueType >( m_Padding );
+				size[d] = end[d] - start[d] + 1;
+			}
+			RegionType region( start, size );
+			region.Crop( largestRegion );
+
+			// distance maps within the region
+			typename BinaryImageType::Pointer binary1 = IsolateLabel( this->m_Input1, label, region );
+			typename BinaryImageType::Pointer binary2 = IsolateLabel( this->m_Input2, label, region );
+			typename DistanceImageType::Pointer distance1 = ComputeDistanceMap( binary1 );
+			typename DistanceImageType::Pointer distance2 = ComputeDistanceMap( binary2 );
+
+			// sample each distance map at the voxels of the other label
+			double maximum12, average12, maximum21, average21;
+			DirectedDistance( binary1, distance2, maximum12, average12 );
+			DirectedDistance( binary2, distance1, maximum21, average21 );
+
+			this->m_HausdorffDistances[label] = std::max( maximum12, maximum21 );
+			this->m_AverageHausdorffDistances[label] = 0.5*( average12 + average21 );
+		}
+
+		return;
+	}
+
+	template< typename TLabelImageType >
+	double BoundingBoxHausdorffDistanceFilter< TLabelImageType >::GetHausdorffDistance( LabelType label ) const
+	{
+		typename std::map< LabelType, double >::const_iterator it = m_HausdorffDistances.find( label );
+		return it == m_HausdorffDistances.end() ? -1 : it->second;
+	}
+
+	template< typename TLabelImageType >
+	double BoundingBoxHausdorffDistanceFilter< TLabelImageType >::GetAverageHausdorffDistance( LabelType label ) const
+	{
+		typename std::map< LabelType, double >::const_iterator it = m_AverageHausdorffDistances.find( label );
+		return it == m_AverageHausdorffDistances.end() ? -1 : it->second;
+	}
+
+	// bounding box of each non-zero label
+	template< typename TLabelImageType >
+	void BoundingBoxHausdorffDistanceFilter< TLabelImageType >::ComputeBoundingBoxes( const LabelImageType * image, std::map< LabelType, BoundingBoxType > & boxes )
+	{
+		ImageRegionConstIteratorWithIndex< LabelImageType > it( image, image->GetBufferedRegion() );
+		for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+		{
+			const LabelType label = it.Get();
+			if( label == 0 )
+			{
+				continue;
+			}
+
+			const IndexType index = it.GetIndex();
+			typename std::map< LabelType, BoundingBoxType >::iterator box = boxes.find( label );
+			if( box == boxes.end() )
+			{
+				boxes[label] = BoundingBoxType( index, index );
+				continue;
+			}
+			for( unsigned int d = 0; d < 3; ++d )
+			{
+				box->second.first[d] = std::min( box->second.first[d], index[d] );
+				box->second.second[d] = std::max( box->second.second[d], index[d] );
+			}
+		}
+
+		return;
+	}
+
+	// binary image of one label limited to the region
+	template< typename TLabelImageType >
+	typename BoundingBoxHausdorffDistanceFilter< TLabelImageType >::BinaryImageType::Pointer
+	BoundingBoxHausdorffDistanceFilter< TLabelImageType >::IsolateLabel( const LabelImageType * image, LabelType label, const RegionType & region )
+	{
+		typename BinaryImageType::Pointer binary = BinaryImageType::New();
+		binary->SetRegions( region );
+		binary->SetOrigin( image->GetOrigin() );
+		binary->SetSpacing( image->GetSpacing() );
+		binary->SetDirection( image->GetDirection() );
+		binary->Allocate();
+
+		ImageRegionConstIterator< LabelImageType > inIt( image, region );
+		ImageRegionIterator< BinaryImageType > outIt( binary, region );
+		for( inIt.GoToBegin(), outIt.GoToBegin(); !inIt.IsAtEnd(); ++inIt, ++outIt )
+		{
+			outIt.Set( inIt.Get() == label ? 1 : 0 );
+		}
+
+		return binary;
+	}
+
+	// distance (in mm) from each voxel to the nearest voxel of the label
+	template< typename TLabelImageType >
+	typename BoundingBoxHausdorffDistanceFilter< TLabelImageType >::DistanceImageType::Pointer
+	BoundingBoxHausdorffDistanceFilter< TLabelImageType >::ComputeDistanceMap( const BinaryImageType * binary )
+	{
+		typename DistanceFilterType::Pointer distance = DistanceFilterType::New();
+		distance->SetInput( binary );
+		distance->SetBackgroundValue( 0 );
+		distance->SetUseImageSpacing( true );
+		distance->SetSquaredDistance( false );
+		distance->SetInsideIsPositive( false );
+		distance->Update();
+
+		return distance->GetOutput();
+	}
+
+	// maximum and mean distance from the voxels of one label to the other label
+	// (the maximum can lie inside the label, e.g. when the other label has holes or several components)
+	template< typename TLabelImageType >
+	void BoundingBoxHausdorffDistanceFilter< TLabelImageType >::DirectedDistance( const BinaryImageType * from, const DistanceImageType * distance, double & maximum, double & average )
+	{
+		const SizeValueType numberOfPixels = from->GetBufferedRegion().GetNumberOfPixels();
+		const unsigned char * mask = from->GetBufferPointer();
+		const float * distances = distance->GetBufferPointer();
+
+		maximum = 0.0;
+		double sum = 0.0;
+		SizeValueType count = 0;
+		for( SizeValueType idx = 0; idx < numberOfPixels; ++idx )
+		{
+			if( !mask[idx] )
+			{
+				continue;
+			}
+
+			// voxels inside the other label have a negative signed distance
+			const double d = std::max( 0.0, static_cast< double >( distances[idx] ) );
+			maximum = std::max( maximum, d );
+			sum += d;
+			++count;
+		}
+
+		average = count > 0 ? sum/count : 0.0;
+		return;
+	}
+
+} // end namespace
+
+#endif
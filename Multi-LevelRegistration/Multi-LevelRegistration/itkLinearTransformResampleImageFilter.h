@@ -0,0 +1,110 @@
+/*
+Purpose: This class resamples an image into the space of a reference image when the transform
+is linear (ScaleVersor3DTransform, AffineTransform or a CompositeTransform made only of these).
+For a linear transform the continuous index of voxel (i+1,j,k) in the moving image is the index
+of voxel (i,j,k) plus a constant vector, so each row is generated by stepping the coordinates
+instead of calling TransformPoint for every voxel. Only the coordinate rows are written to flat
+arrays, which the compiler can auto-vectorize; the bounds checks and the gather of the neighboring
+pixels for the interpolation are scalar. Transforms that cannot be collapsed to a
+single matrix and offset fall back to the ResampleImageFilter.
+
+*/
+
+#ifndef __itkLinearTransformResampleImageFilter_h
+#define __itkLinearTransformResampleImageFilter_h
+
+// include files
+#include "itkImage.h"
+#include "itkTransform.h"
+#include "itkMatrixOffsetTransformBase.h"
+#include "itkCompositeTransform.h"
+#include "itkMultiThreader.h"
+
+namespace itk
+{
+// class LinearTransformResampleImageFilter
+template< typename TImageType >
+class LinearTransformResampleImageFilter: public Object
+{
+public:
+	// default ITK
+	typedef LinearTransformResampleImageFilter	Self;
+	typedef Object								Superclass;
+	typedef SmartPointer< Self >				Pointer;
+	typedef SmartPointer< const Self >			ConstPointer;
+
+	// definitions
+	typedef TImageType									ImageType;
+	typedef typename ImageType::PixelType				PixelType;
+	typedef itk::ImageBase< 3 >							ReferenceImageType;
+	typedef itk::Transform< double, 3, 3 >				TransformType;
+	typedef itk::MatrixOffsetTransformBase< double, 3, 3 >	LinearTransformType;
+	typedef itk::CompositeTransform< double, 3 >		CompositeTransformType;
+	typedef typename LinearTransformType::MatrixType	MatrixType;
+	typedef typename LinearTransformType::OffsetType	OffsetType;
+
+	// method for creation
+	itkNewMacro(Self);
+
+	// run-time type information and related methods
+	itkTypeMacro(LinearTransformResampleImageFilter, Object);
+
+	// set inputs
+	itkSetConstObjectMacro( ReferenceImage, ReferenceImageType );
+	itkSetObjectMacro( Input, ImageType );
+	itkSetConstObjectMacro( Transform, TransformType );
+	itkSetMacro( DefaultPixelValue, PixelType );
+
+	// get results
+	itkGetObjectMacro( Output, ImageType );
+
+	// use NN interpolation during resampling
+	void NearestNeighborInterpolateOn()
+	{
+		m_NearestNeighbor = true;
+	}
+	void NearestNeighborInterpolateOff()
+	{
+		m_NearestNeighbor = false;
+	}
+
+	// collapse a linear or composite-of-linear transform into a single matrix and offset
+	static bool CollapseTransform( const TransformType * transform, MatrixType & matrix, OffsetType & offset );
+
+	// perform function
+	void Update();
+
+protected:
+	// constructor
+	LinearTransformResampleImageFilter();
+
+	// destructor
+	virtual ~LinearTransformResampleImageFilter() {}
+
+private:
+	// inputs
+	typename ReferenceImageType::ConstPointer m_ReferenceImage;
+	typename ImageType::Pointer m_Input;
+	typename TransformType::ConstPointer m_Transform;
+	PixelType m_DefaultPixelValue;
+	bool m_NearestNeighbor;
+
+	// output
+	typename ImageType::Pointer m_Output;
+
+	// mapping from reference index to input continuous index: cidx = A*idx + b
+	double m_IndexMatrix[3][3];
+	double m_IndexOffset[3];
+
+	// threading
+	static ITK_THREAD_RETURN_TYPE ThreaderCallback( void * arg );
+	void ThreadedResample( unsigned int threadId, unsigned int numberOfThreads );
+	void ResampleWithFilter();
+};
+} // end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkLinearTransformResampleImageFilter.hxx"
+#endif
+
+#endif
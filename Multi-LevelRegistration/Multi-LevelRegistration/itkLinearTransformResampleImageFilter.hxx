@@ -0,0 +1,289 @@
+#ifndef __itkLinearTransformResampleImageFilter_hxx
+#define __itkLinearTransformResampleImageFilter_hxx
+
+#include "itkLinearTransformResampleImageFilter.h"
+#include "itkResampleImageFilter.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
+#include "itkNumericTraits.h"
+#include <vector>
+#include <cmath>
+
+namespace itk
+{
+	// constructor
+	template< typename TImageType >
+	LinearTransformResampleImageFilter< TImageType >::LinearTransformResampleImageFilter():
+		m_ReferenceImage( ITK_NULLPTR ),	// defined by user
+		m_Input( ITK_NULLPTR ),	// defined by user
+		m_Transform( ITK_NULLPTR ),	// defined by user
+		m_DefaultPixelValue( NumericTraits< PixelType >::ZeroValue() ),
+		m_NearestNeighbor( false )
+	{}
+
+	template< typename TImageType >
+	bool LinearTransformResampleImageFilter< TImageType >::CollapseTransform( const TransformType * transform, MatrixType & matrix, OffsetType & offset )
+	{
+		// ScaleVersor3DTransform and AffineTransform both derive from MatrixOffsetTransformBase
+		const LinearTransformType * linear = dynamic_cast< const LinearTransformType * >( transform );
+		if( linear )
+		{
+			matrix = linear->GetMatrix();
+			offset = linear->GetOffset();
+			return true;
+		}
+
+		const CompositeTransformType * composite = dynamic_cast< const CompositeTransformType * >( transform );
+		if( !composite )
+		{
+			return false;
+		}
+
+		// the composite transform applies the last added transform first
+		matrix.SetIdentity();
+		offset.Fill( 0.0 );
+		for( int i = static_cast< int >( composite->GetNumberOfTransforms() ) - 1; i >= 0; --i )
+		{
+			MatrixType nthMatrix;
+			OffsetType nthOffset;
+			if( !CollapseTransform( composite->GetNthTransformConstPointer( i ), nthMatrix, nthOffset ) )
+			{
+				return false;
+			}
+			offset = nthMatrix*offset + nthOffset;
+			matrix = nthMatrix*matrix;
+		}
+
+		return true;
+	}
+
+	template< typename TImageType >
+	void LinearTransformResampleImageFilter< TImageType >::Update()
+	{
+		// error checking
+		if( !m_ReferenceImage )
+		{
+			itkExceptionMacro( << "ReferenceImage not present" );
+		}
+		if( !m_Input )
+		{
+			itkExceptionMacro( << "Input not present" );
+		}
+		if( !m_Transform )
+		{
+			itkExceptionMacro( << "Transform not present" );
+		}
+
+		// use the general resampler if the transform is not linear
+		MatrixType matrix;
+		OffsetType offset;
+		if( !CollapseTransform( this->m_Transform, matrix, offset ) )
+		{
+			ResampleWithFilter();
+			return;
+		}
+
+		// reference index -> physical point
+		MatrixType indexToPhysical;
+		for( unsigned int r = 0; r < 3; ++r )
+		{
+			for( unsigned int c = 0; c < 3; ++c )
+			{
+				indexToPhysical[r][c] = this->m_ReferenceImage->GetDirection()[r][c] * this->m_ReferenceImage->GetSpacing()[c];
+			}
+		}
+
+		// physical point -> input continuous index (relative to the start of the buffer)
+		MatrixType physicalToIndex;
+		for( unsigned int r = 0; r < 3; ++r )
+		{
+			for( unsigned int c = 0; c < 3; ++c )
+			{
+				physicalToIndex[r][c] = this->m_Input->GetPhysicalPointToIndex()[r][c];
+			}
+		}
+
+		// combine into cidx = A*idx + b
+		MatrixType A = physicalToIndex*matrix*indexToPhysical;
+		OffsetType referenceOrigin, inputOrigin;
+		for( unsigned int d = 0; d < 3; ++d )
+		{
+			referenceOrigin[d] = this->m_ReferenceImage->GetOrigin()[d];
+			inputOrigin[d] = this->m_Input->GetOrigin()[d];
+		}
+		OffsetType b = physicalToIndex*( matrix*referenceOrigin + offset - inputOrigin );
+		for( unsigned int r = 0; r < 3; ++r )
+		{
+			for( unsigned int c = 0; c < 3; ++c )
+			{
+				this->m_IndexMatrix[r][c] = A[r][c];
+			}
+			this->m_IndexOffset[r] = b[r] - this->m_Input->GetBufferedRegion().GetIndex()[r];
+		}
+
+		// allocate output in the space of the reference image
+		this->m_Output = ImageType::New();
+		this->m_Output->SetRegions( this->m_ReferenceImage->GetLargestPossibleRegion() );
+		this->m_Output->SetOrigin( this->m_ReferenceImage->GetOrigin() );
+		this->m_Output->SetSpacing( this->m_ReferenceImage->GetSpacing() );
+		this->m_Output->SetDirection( this->m_ReferenceImage->GetDirection() );
+		this->m_Output->Allocate();
+
+		// split the output slices across the available threads
+		MultiThreader::Pointer threader = MultiThreader::New();
+		threader->SetSingleMethod( this->ThreaderCallback, this );
+		threader->SingleMethodExecute();
+
+		return;
+	}
+
+	template< typename TImageType >
+	ITK_THREAD_RETURN_TYPE LinearTransformResampleImageFilter< TImageType >::ThreaderCallback( void * arg )
+	{
+		MultiThreader::ThreadInfoStruct * info = static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+		Self * self = static_cast< Self * >( info->UserData );
+		self->ThreadedResample( info->ThreadID, info->NumberOfThreads );
+		return ITK_THREAD_RETURN_VALUE;
+	}
+
+	template< typename TImageType >
+	void LinearTransformResampleImageFilter< TImageType >::ThreadedResample( unsigned int threadId, unsigned int numberOfThreads )
+	{
+		// determine the slab of slices handled by this thread
+		const typename ImageType::RegionType region = this->m_Output->GetBufferedRegion();
+		const SizeValueType nx = region.GetSize()[0];
+		const SizeValueType ny = region.GetSize()[1];
+		const SizeValueType nz = region.GetSize()[2];
+		const SizeValueType slicesPerThread = ( nz + numberOfThreads - 1 ) / numberOfThreads;
+		const SizeValueType firstSlice = threadId * slicesPerThread;
+		if( firstSlice >= nz )
+		{
+			return;
+		}
+		const SizeValueType lastSlice = std::min( nz, firstSlice + slicesPerThread );
+
+		// input buffer
+		const PixelType * input = this->m_Input->GetBufferPointer();
+		const long sx = static_cast< long >( this->m_Input->GetBufferedRegion().GetSize()[0] );
+		const long sy = static_cast< long >( this->m_Input->GetBufferedRegion().GetSize()[1] );
+		const long sz = static_cast< long >( this->m_Input->GetBufferedRegion().GetSize()[2] );
+		const long strideY = sx;
+		const long strideZ = sx*sy;
+
+		// bounds used to cast the linear interpolation back into the pixel type
+		const double minPixel = static_cast< double >( NumericTraits< PixelType >::NonpositiveMin() );
+		const double maxPixel = static_cast< double >( NumericTraits< PixelType >::max() );
+
+		// per-row coordinate buffers
+		std::vector< double > xs( nx ), ys( nx ), zs( nx );
+		const double stepX = this->m_IndexMatrix[0][0];
+		const double stepY = this->m_IndexMatrix[1][0];
+		const double stepZ = this->m_IndexMatrix[2][0];
+
+		const long i0 = region.GetIndex()[0];
+		for( SizeValueType kk = firstSlice; kk < lastSlice; ++kk )
+		{
+			const long k = region.GetIndex()[2] + static_cast< long >( kk );
+			for( SizeValueType jj = 0; jj < ny; ++jj )
+			{
+				const long j = region.GetIndex()[1] + static_cast< long >( jj );
+
+				// continuous index of the first voxel of the row
+				const double x0 = this->m_IndexMatrix[0][0]*i0 + this->m_IndexMatrix[0][1]*j + this->m_IndexMatrix[0][2]*k + this->m_IndexOffset[0];
+				const double y0 = this->m_IndexMatrix[1][0]*i0 + this->m_IndexMatrix[1][1]*j + this->m_IndexMatrix[1][2]*k + this->m_IndexOffset[1];
+				const double z0 = this->m_IndexMatrix[2][0]*i0 + this->m_IndexMatrix[2][1]*j + this->m_IndexMatrix[2][2]*k + this->m_IndexOffset[2];
+
+				// step along the row (independent iterations so the loop vectorizes)
+				double * px = &xs[0];
+				double * py = &ys[0];
+				double * pz = &zs[0];
+				for( SizeValueType i = 0; i < nx; ++i )
+				{
+					px[i] = x0 + stepX*i;
+					py[i] = y0 + stepY*i;
+					pz[i] = z0 + stepZ*i;
+				}
+
+				PixelType * output = this->m_Output->GetBufferPointer() + ( kk*ny + jj )*nx;
+				for( SizeValueType i = 0; i < nx; ++i )
+				{
+					const double x = px[i];
+					const double y = py[i];
+					const double z = pz[i];
+
+					// same buffer bounds as InterpolateImageFunction::IsInsideBuffer
+					if( x < -0.5 || y < -0.5 || z < -0.5 || x >= sx - 0.5 || y >= sy - 0.5 || z >= sz - 0.5 )
+					{
+						output[i] = this->m_DefaultPixelValue;
+						continue;
+					}
+
+					if( this->m_NearestNeighbor )
+					{
+						const long xi = static_cast< long >( std::floor( x + 0.5 ) );
+						const long yi = static_cast< long >( std::floor( y + 0.5 ) );
+						const long zi = static_cast< long >( std::floor( z + 0.5 ) );
+						output[i] = input[ zi*strideZ + yi*strideY + xi ];
+						continue;
+					}
+
+					// trilinear interpolation with neighbors clamped to the buffer
+					long xa = static_cast< long >( std::floor( x ) );
+					long ya = static_cast< long >( std::floor( y ) );
+					long za = static_cast< long >( std::floor( z ) );
+					double fx = x - xa;
+					double fy = y - ya;
+					double fz = z - za;
+					if( xa < 0 ) { xa = 0; fx = 0.0; }
+					if( ya < 0 ) { ya = 0; fy = 0.0; }
+					if( za < 0 ) { za = 0; fz = 0.0; }
+					const long xb = std::min( xa + 1, sx - 1 );
+					const long yb = std::min( ya + 1, sy - 1 );
+					const long zb = std::min( za + 1, sz - 1 );
+
+					const PixelType * pa = input + za*strideZ;
+					const PixelType * pb = input + zb*strideZ;
+					const double c00 = pa[ya*strideY + xa] + fx*( pa[ya*strideY + xb] - static_cast< double >( pa[ya*strideY + xa] ) );
+					const double c10 = pa[yb*strideY + xa] + fx*( pa[yb*strideY + xb] - static_cast< double >( pa[yb*strideY + xa] ) );
+					const double c01 = pb[ya*strideY + xa] + fx*( pb[ya*strideY + xb] - static_cast< double >( pb[ya*strideY + xa] ) );
+					const double c11 = pb[yb*strideY + xa] + fx*( pb[yb*strideY + xb] - static_cast< double >( pb[yb*strideY + xa] ) );
+					const double c0 = c00 + fy*( c10 - c00 );
+					const double c1 = c01 + fy*( c11 - c01 );
+					const double value = c0 + fz*( c1 - c0 );
+
+					output[i] = static_cast< PixelType >( std::max( minPixel, std::min( maxPixel, value ) ) );
+				}
+			}
+		}
+
+		return;
+	}
+
+	// general path for transforms that cannot be collapsed
+	template< typename TImageType >
+	void LinearTransformResampleImageFilter< TImageType >::ResampleWithFilter()
+	{
+		typedef itk::ResampleImageFilter< ImageType, ImageType >	ResampleFilterType;
+		typename ResampleFilterType::Pointer resample = ResampleFilterType::New();
+		resample->SetSize( this->m_ReferenceImage->GetLargestPossibleRegion().GetSize() );
+		resample->SetOutputStartIndex( this->m_ReferenceImage->GetLargestPossibleRegion().GetIndex() );
+		resample->SetOutputOrigin( this->m_ReferenceImage->GetOrigin() );
+		resample->SetOutputSpacing( this->m_ReferenceImage->GetSpacing() );
+		resample->SetOutputDirection( this->m_ReferenceImage->GetDirection() );
+		resample->SetDefaultPixelValue( this->m_DefaultPixelValue );
+		resample->SetInput( this->m_Input );
+		resample->SetTransform( this->m_Transform );
+
+		typedef itk::NearestNeighborInterpolateImageFunction< ImageType, double > NearestNeighborType;
+		if( this->m_NearestNeighbor )
+		{
+			resample->SetInterpolator( NearestNeighborType::New() );
+		}
+
+		resample->Update();
+		this->m_Output = resample->GetOutput();
+		return;
+	}
+
+} // end namespace
+
+#endif
@@ -17,7 +17,12 @@ transform prior to validation.
 #include "itkChangeInformationImageFilter.h"
 #include "itkResampleImageFilter.h"
 #include "itkNearestNeighborInterpolateImageFunction.h"
-#include "itkExtractImageFilter.h"
+#include "itkResampleImageAndLabelMapFilter.h"
+#include "itkLinearTransformResampleImageFilter.h"
+
+#include "itkSimpleFastMutexLock.h"
+
+#include <map>
 
 namespace itk
 {
@@ -35,6 +40,9 @@ public:
 	// definitions
 	typedef itk::CompositeTransform< double, 3 >	CompositeTransformType;
 	typedef itk::ScaleVersor3DTransform< double >	TransformType;
+	typedef itk::Transform< double, 3, 3 >			TransformBaseType;
+	typedef itk::Matrix< double, 3, 3 >				TransformMatrixType;
+	typedef itk::Vector< double, 3 >				TransformOffsetType;
 	typedef itk::Image< TPixelType, 3 >				ImageType;
 	typedef itk::Image< unsigned char, 3 >			MaskImageType;
 	
@@ -62,10 +70,6 @@ public:
 	itkGetObjectMacro( TransformedImage, ImageType );
 	itkGetObjectMacro( TransformedLabelMap, MaskImageType );
 	itkGetObjectMacro( CompositeTransform, CompositeTransformType );
-	itkGetObjectMacro( FixedCroppedImage, ImageType );
-	itkGetObjectMacro( FixedCroppedLabelMap, MaskImageType );
-	itkGetObjectMacro( MovingCroppedImage, ImageType );
-	itkGetObjectMacro( MovingCroppedLabelMap, MaskImageType );
 
 	// Harden transform flag
 	void HardenTransformOn()
@@ -89,7 +93,7 @@ public:
 		m_ResampleImage = false;
 	}
 
-	// crop image
+	// crop image: only the ROI region/corners are computed, registration uses the full images limited to them
 	void CropImageOn()
 	{
 		m_CropImage = true;
@@ -98,96 +102,50 @@ public:
 	{
 		m_CropImage = false;
 	}
+	itkGetConstMacro( FixedCropRegion, typename ImageType::RegionType );
+	itkGetConstMacro( ROIStartPoint, typename ImageType::PointType );
+	itkGetConstMacro( ROIEndPoint, typename ImageType::PointType );
 
 	// perform function
 	void Update();
+
+	// copy for use on another thread: images are shared (not copied), transforms are cloned, no ROI is set
+	Pointer Snapshot() const;
 	template< typename TImageType > 
 	typename TImageType::Pointer ResampleImage(typename TImageType::Pointer image, TransformType::Pointer transform)
 	{
-		// set up resampling object
-		typedef itk::ResampleImageFilter< TImageType, TImageType >	ResampleFilterType;
-		ResampleFilterType::Pointer resample = ResampleFilterType::New();
-
 		if (!this->m_FixedImage)
 		{
 			std::cout << "Fixed Image not defined. " << std::endl;
 			return image;
 		}
 
-		// define image resampling with respect to fixed image
-		resample->SetSize(this->m_FixedImage->GetLargestPossibleRegion().GetSize());
-		resample->SetOutputOrigin(this->m_FixedImage->GetOrigin());
-		resample->SetOutputSpacing(this->m_FixedImage->GetSpacing());
-		resample->SetOutputDirection(this->m_FixedImage->GetDirection());
-
-		// input parameters
-		resample->SetInput(image);
-		resample->SetTransform(transform);
-
-		// define interpolator
-		ResampleFilterType::InterpolatorType * linInterpolator = resample->GetInterpolator();
-		typedef itk::NearestNeighborInterpolateImageFunction< TImageType, double > NearestNeighborType;
-		NearestNeighborType::Pointer nnInterpolator = NearestNeighborType::New();
-
-		if (this->m_NearestNeighbor)
-		{
-			resample->SetInterpolator(nnInterpolator);
-			std::cout << "Nearest neighbor interpolator." << std::endl;
-		}
-		else
-		{
-			resample->SetInterpolator(linInterpolator);
-		}
-
-		// apply
-		resample->Update();
-
-		return resample->GetOutput();
+		return ResampleImageWithTransform< TImageType >(image, transform.GetPointer());
 	};
 
 	template< typename TImageType >
 	typename TImageType::Pointer ResampleImage(typename TImageType::Pointer image, CompositeTransformType::Pointer transform)
 	{
-		// set up resampling object
-		typedef itk::ResampleImageFilter< TImageType, TImageType >	ResampleFilterType;
-		ResampleFilterType::Pointer resample = ResampleFilterType::New();
-
 		if (!this->m_FixedImage)
 		{
 			std::cout << "Fixed Image not defined. " << std::endl;
 			return image;
 		}
 
-		// define image resampling with respect to fixed image
-		resample->SetSize(this->m_FixedImage->GetLargestPossibleRegion().GetSize());
-		resample->SetOutputOrigin(this->m_FixedImage->GetOrigin());
-		resample->SetOutputSpacing(this->m_FixedImage->GetSpacing());
-		resample->SetOutputDirection(this->m_FixedImage->GetDirection());
-
-		// input parameters
-		resample->SetInput(image);
-		resample->SetTransform(transform);
-
-		// define interpolator
-		ResampleFilterType::InterpolatorType * linInterpolator = resample->GetInterpolator();
-		typedef itk::NearestNeighborInterpolateImageFunction< TImageType, double > NearestNeighborType;
-		NearestNeighborType::Pointer nnInterpolator = NearestNeighborType::New();
-
-		if (this->m_NearestNeighbor)
-		{
-			resample->SetInterpolator(nnInterpolator);
-			std::cout << "Nearest neighbor interpolator." << std::endl;
-		}
-		else
-		{
-			resample->SetInterpolator(linInterpolator);
-		}
+		return ResampleImageWithTransform< TImageType >(image, transform.GetPointer());
+	};
 
-		// apply
-		resample->Update();
+	// resample an image (linear) and its label map (nearest neighbor) in a single pass
+	void ResampleImageAndLabelMap(typename ImageType::Pointer image, MaskImageType::Pointer labelMap, const TransformBaseType * transform,
+		typename ImageType::Pointer & outputImage, MaskImageType::Pointer & outputLabelMap);
 
-		return resample->GetOutput();
-	};
+	// resampled images are cached until the next transform is added
+	void ClearResampleCache()
+	{
+		m_ResampleCacheLock.Lock();
+		m_ResampleCache.clear();
+		m_ResampleCacheLock.Unlock();
+	}
 
 	// use NN interpolation during resampling
 	void NearestNeighborInterpolateOn()
@@ -224,129 +182,226 @@ private:
 	MaskImageType::Pointer m_MovingLabelMap;
 	typename ImageType::Pointer m_TransformedImage;
 	MaskImageType::Pointer m_TransformedLabelMap;
-	typename ImageType::Pointer m_FixedCroppedImage;
-	MaskImageType::Pointer m_FixedCroppedLabelMap;
-	typename ImageType::Pointer m_MovingCroppedImage;
-	MaskImageType::Pointer m_MovingCroppedLabelMap;
 
 	// flags
 	bool m_HardenTransform;
 	bool m_ResampleImage;
 	bool m_NearestNeighbor;
 	bool m_CropImage;
-	typename ImageType::RegionType m_CropRegion;
+	typename ImageType::RegionType m_FixedCropRegion;
+	typename ImageType::PointType m_ROIStartPoint;
+	typename ImageType::PointType m_ROIEndPoint;
 
 	// ROI
 	const char * m_ROIFilename;
 	std::vector<float> m_ROI;
 	template< typename TImageType >
-	typename TImageType::Pointer CropImage(typename TImageType::Pointer image)	// used with reading in ROI from *.ascv file
+	typename TImageType::RegionType ComputeCropRegion(typename TImageType::Pointer image)	// used with reading in ROI from *.ascv file
 	{
-		std::vector<float>::iterator it = m_ROI.begin();
-
-		// extract center and radius
-		double c[3] = { -*(it), -*(it + 1), *(it + 2) };
-		double r[3] = { *(it + 3), *(it + 4), *(it + 5) };
-
 		// create size of mask according to the roi array
 		// set start index of mask according to the roi array
-		TImageType::PointType startPoint, endPoint;
-		startPoint[0] = c[0] - r[0];
-		startPoint[1] = c[1] - r[1];
-		startPoint[2] = c[2] - r[2];
-
-		// find end index
-		endPoint[0] = c[0] + r[0];
-		endPoint[1] = c[1] + r[1];
-		endPoint[2] = c[2] + r[2];
+		ComputeROIPoints();
 
-		// convert to indices
+		// convert all 8 corners to indices (the axes of a hardened image may be oblique to the ROI box)
 		TImageType::IndexType startIndex, endIndex;
-		image->TransformPhysicalPointToIndex(startPoint, startIndex);
-		image->TransformPhysicalPointToIndex(endPoint, endIndex);
-
-		// plug into region
-		TImageType::SizeType regionSize;
-		regionSize[0] = abs(startIndex[0] - endIndex[0]);
-		regionSize[1] = abs(startIndex[1] - endIndex[1]);
-		regionSize[2] = abs(startIndex[2] - endIndex[2]);
-
-		m_CropRegion.SetSize(regionSize);
-		m_CropRegion.SetIndex(startIndex);
-		m_CropRegion.Crop(image->GetLargestPossibleRegion());
-
-		// extract cropped image
-		typedef itk::ExtractImageFilter< TImageType, TImageType > ExtractFilterType;
-		ExtractFilterType::Pointer extract = ExtractFilterType::New();
-		extract->SetExtractionRegion(m_CropRegion);
-		extract->SetInput(image);
-		extract->SetDirectionCollapseToIdentity();
-
-		// update filter
-		try
+		for (int corner = 0; corner < 8; ++corner)
 		{
-			extract->Update();
+			TImageType::PointType point;
+			for (int d = 0; d < 3; ++d)
+			{
+				point[d] = (corner & (1 << d)) ? m_ROIEndPoint[d] : m_ROIStartPoint[d];
+			}
+			TImageType::IndexType index;
+			image->TransformPhysicalPointToIndex(point, index);
+			for (int d = 0; d < 3; ++d)
+			{
+				startIndex[d] = corner == 0 ? index[d] : std::min(startIndex[d], index[d]);
+				endIndex[d] = corner == 0 ? index[d] : std::max(endIndex[d], index[d]);
+			}
 		}
-		catch (itk::ExceptionObject & err)
+
+		// plug into region (bounding box of the corners)
+		TImageType::SizeType regionSize;
+		for (int d = 0; d < 3; ++d)
 		{
-			std::cerr << "Exception Object Caught!" << std::endl;
-			std::cerr << err << std::endl;
-			std::cerr << std::endl;
+			regionSize[d] = endIndex[d] - startIndex[d];
 		}
 
-		return extract->GetOutput();
+		typename TImageType::RegionType cropRegion;
+		cropRegion.SetSize(regionSize);
+		cropRegion.SetIndex(startIndex);
+		cropRegion.Crop(image->GetLargestPossibleRegion());
+
+		return cropRegion;
 	};
 
 	void ExtractROIPoints();	// used with reading in ROI from *.ascv file
-
-	typename ImageType::Pointer CropImage(typename ImageType::Pointer image, std::vector<float> roi);
+	void ComputeROIPoints();	// physical corners of the ROI box
 
 	// applying transform
 	void HardenTransform();
+
+	// header of the image moved by the inverse of T(x) = Mx + o: voxel axes M^-1 D S, origin M^-1(origin - o)
+	// the scale of M goes into the spacing; returns false if M shears the voxel axes (no valid header)
 	template< typename TImageType >
-	typename TImageType::Pointer ResampleImage(typename TImageType::Pointer image)
+	bool HardenedGeometry(typename TImageType::Pointer image, const TransformMatrixType & inverse, const TransformOffsetType & offset,
+		typename TImageType::PointType & newOrigin, typename TImageType::DirectionType & newDirection, typename TImageType::SpacingType & newSpacing)
 	{
-		// set up resampling object
-		typedef itk::ResampleImageFilter< TImageType, TImageType >	ResampleFilterType;
-		ResampleFilterType::Pointer resample = ResampleFilterType::New();
+		const double tolerance = 1e-6;
 
-		// define image resampling with respect to fixed image
-		resample->SetSize(this->m_FixedImage->GetLargestPossibleRegion().GetSize());
-		resample->SetOutputOrigin(this->m_FixedImage->GetOrigin());
-		resample->SetOutputSpacing(this->m_FixedImage->GetSpacing());
-		resample->SetOutputDirection(this->m_FixedImage->GetDirection());
+		// voxel axes (columns of M^-1 D S)
+		TransformMatrixType axes = inverse*image->GetDirection();
+		for (unsigned int c = 0; c < 3; ++c)
+		{
+			double length = 0.0;
+			for (unsigned int r = 0; r < 3; ++r)
+			{
+				axes[r][c] *= image->GetSpacing()[c];
+				length += axes[r][c]*axes[r][c];
+			}
+			newSpacing[c] = std::sqrt(length);
+			for (unsigned int r = 0; r < 3; ++r)
+			{
+				newDirection[r][c] = axes[r][c]/newSpacing[c];
+			}
+		}
 
-		// input parameters
-		resample->SetInput(image);
+		// the axes have to stay orthogonal
+		for (unsigned int a = 0; a < 3; ++a)
+		{
+			for (unsigned int b = a + 1; b < 3; ++b)
+			{
+				double dot = 0.0;
+				for (unsigned int r = 0; r < 3; ++r)
+				{
+					dot += newDirection[r][a]*newDirection[r][b];
+				}
+				if (std::abs(dot) > tolerance)
+				{
+					return false;
+				}
+			}
+		}
+
+		// new origin: M^-1(origin - o)
+		TransformOffsetType origin;
+		for (unsigned int d = 0; d < 3; ++d)
+		{
+			origin[d] = image->GetOrigin()[d] - offset[d];
+		}
+		origin = inverse*origin;
+		for (unsigned int d = 0; d < 3; ++d)
+		{
+			newOrigin[d] = origin[d];
+		}
+
+		return true;
+	};
+
+	// write a hardened header without touching voxels
+	template< typename TImageType >
+	typename TImageType::Pointer HardenImage(typename TImageType::Pointer image, const typename TImageType::PointType & newOrigin,
+		const typename TImageType::DirectionType & newDirection, const typename TImageType::SpacingType & newSpacing)
+	{
+		// allocate hardening filter
+		typedef itk::ChangeInformationImageFilter< TImageType > HardenTransformFilter;
+		typename HardenTransformFilter::Pointer harden = HardenTransformFilter::New();
+		harden->SetInput(image);
+
+		// set new parameters
+		harden->SetOutputOrigin(newOrigin);
+		harden->SetOutputDirection(newDirection);
+		harden->SetOutputSpacing(newSpacing);
+
+		// turn change flags on
+		harden->ChangeOriginOn();
+		harden->ChangeDirectionOn();
+		harden->ChangeSpacingOn();
+
+		harden->Update();
+		return harden->GetOutput();
+	};
+	template< typename TImageType >
+	typename TImageType::Pointer ResampleImage(typename TImageType::Pointer image)
+	{
 		if (m_CompositeTransform->IsTransformQueueEmpty())
 		{
-			resample->SetTransform(m_InitialTransform);
+			return ResampleImageWithTransform< TImageType >(image, m_InitialTransform.GetPointer());
 		}
 		else
 		{
-			resample->SetTransform(m_CompositeTransform);
+			return ResampleImageWithTransform< TImageType >(image, m_CompositeTransform.GetPointer());
 		}
+	};
 
-		// define interpolator
-		ResampleFilterType::InterpolatorType * linInterpolator = resample->GetInterpolator();
-		typedef itk::NearestNeighborInterpolateImageFunction< TImageType, double > NearestNeighborType;
-		NearestNeighborType::Pointer nnInterpolator = NearestNeighborType::New();
+	// resample into the fixed image space, stepping along rows for linear transforms
+	// (nothing is printed here: validation resamples on another thread and collects its own output)
+	template< typename TImageType >
+	typename TImageType::Pointer ResampleImageWithTransform(typename TImageType::Pointer image, const TransformBaseType * transform)
+	{
+		return ResampleImageWithTransform< TImageType >(image, transform, this->m_NearestNeighbor);
+	};
 
-		if (this->m_NearestNeighbor)
+	template< typename TImageType >
+	typename TImageType::Pointer ResampleImageWithTransform(typename TImageType::Pointer image, const TransformBaseType * transform, bool nearestNeighbor)
+	{
+		// reuse a previous resample of the same image with the same transform
+		ResampleCacheKey key = CreateResampleCacheKey(image.GetPointer(), transform, nearestNeighbor);
+		typename TImageType::Pointer cachedImage = static_cast< TImageType * >(FindResampleCache(key).GetPointer());
+		if (cachedImage)
 		{
-			resample->SetInterpolator(nnInterpolator);
-			std::cout << "Nearest neighbor interpolator." << std::endl;
+			return cachedImage;
 		}
-		else
+
+		typedef itk::LinearTransformResampleImageFilter< TImageType >	ResampleFilterType;
+		typename ResampleFilterType::Pointer resample = ResampleFilterType::New();
+
+		// define image resampling with respect to fixed image
+		resample->SetReferenceImage(this->m_FixedImage);
+
+		// input parameters
+		resample->SetInput(image);
+		resample->SetTransform(transform);
+
+		// define interpolator
+		if (nearestNeighbor)
 		{
-			resample->SetInterpolator(linInterpolator);
+			resample->NearestNeighborInterpolateOn();
 		}
 
 		// apply
 		resample->Update();
 
+		AddToResampleCache(key, resample->GetOutput());
 		return resample->GetOutput();
 	};
+
+	// resample cache keyed on image identity, transform parameters and interpolator
+	struct ResampleCacheKey
+	{
+		const void * image;
+		ModifiedTimeType imageTime;
+		const void * reference;
+		ModifiedTimeType referenceTime;
+		bool nearestNeighbor;
+		std::vector< double > parameters;
+
+		bool operator<(const ResampleCacheKey & other) const
+		{
+			if (image != other.image) { return image < other.image; }
+			if (imageTime != other.imageTime) { return imageTime < other.imageTime; }
+			if (reference != other.reference) { return reference < other.reference; }
+			if (referenceTime != other.referenceTime) { return referenceTime < other.referenceTime; }
+			if (nearestNeighbor != other.nearestNeighbor) { return nearestNeighbor < other.nearestNeighbor; }
+			return parameters < other.parameters;
+		}
+	};
+	std::map< ResampleCacheKey, DataObject::Pointer > m_ResampleCache;
+	SimpleFastMutexLock m_ResampleCacheLock;	// validation may resample from another thread
+	DataObject::Pointer FindResampleCache(const ResampleCacheKey & key);
+	void AddToResampleCache(const ResampleCacheKey & key, DataObject * image);
+	ResampleCacheKey CreateResampleCacheKey(const DataObject * image, const TransformBaseType * transform, bool nearestNeighbor);
+	void AppendTransformParameters(const TransformBaseType * transform, std::vector< double > & parameters);
 };
 } // end namespace
 
@@ -3,6 +3,7 @@
 
 #include "itkManageTransformsFilter.h"
 #include "itkImageRegionIterator.h"
+#include "vnl/algo/vnl_determinant.h"
 
 namespace itk
 {
@@ -20,8 +21,6 @@ namespace itk
 		m_CropImage( false )
 	{
 		m_CompositeTransform = CompositeTransformType::New();
-		m_FixedCroppedImage = ImageType::New();
-		m_MovingCroppedImage = ImageType::New();
 		m_ROI.assign(6, 0.0);
 	}
 
@@ -44,6 +43,71 @@ namespace itk
 	void ManageTransformsFilter< typename TPixelType >::AddTransform(TransformType::Pointer transform)
 	{
 		this->m_CompositeTransform->AddTransform( transform );
+
+		// resamples from the previous level will not be requested again
+		ClearResampleCache();
+	}
+
+	template< typename TPixelType >
+	typename ManageTransformsFilter< TPixelType >::Pointer ManageTransformsFilter< TPixelType >::Snapshot() const
+	{
+		Pointer snapshot = Self::New();
+
+		// images are only read
+		snapshot->m_FixedImage = this->m_FixedImage;
+		snapshot->m_FixedLabelMap = this->m_FixedLabelMap;
+		snapshot->m_MovingImage = this->m_MovingImage;
+		snapshot->m_MovingLabelMap = this->m_MovingLabelMap;
+		snapshot->m_TransformedImage = this->m_TransformedImage;
+		snapshot->m_TransformedLabelMap = this->m_TransformedLabelMap;
+
+		// transforms
+		if( this->m_InitialTransform )
+		{
+			snapshot->m_InitialTransform = this->m_InitialTransform->Clone();
+		}
+		snapshot->m_CompositeTransform = this->m_CompositeTransform->Clone();
+		snapshot->m_NearestNeighbor = this->m_NearestNeighbor;
+
+		return snapshot;
+	}
+
+	// build the cache key for resampling an image through a transform
+	template< typename TPixelType >
+	typename ManageTransformsFilter< TPixelType >::ResampleCacheKey ManageTransformsFilter< TPixelType >::CreateResampleCacheKey(const DataObject * image, const TransformBaseType * transform, bool nearestNeighbor)
+	{
+		ResampleCacheKey key;
+		key.image = image;
+		key.imageTime = image->GetMTime();
+		key.reference = this->m_FixedImage.GetPointer();
+		key.referenceTime = this->m_FixedImage->GetMTime();
+		key.nearestNeighbor = nearestNeighbor;
+		AppendTransformParameters( transform, key.parameters );
+		return key;
+	}
+
+	// flatten the parameters of a (possibly composite) transform
+	// each transform is length-prefixed so a composite of one transform matches the transform itself
+	template< typename TPixelType >
+	void ManageTransformsFilter< TPixelType >::AppendTransformParameters(const TransformBaseType * transform, std::vector< double > & parameters)
+	{
+		const CompositeTransformType * composite = dynamic_cast< const CompositeTransformType * >( transform );
+		if( composite )
+		{
+			for( unsigned int i = 0; i < composite->GetNumberOfTransforms(); ++i )
+			{
+				AppendTransformParameters( composite->GetNthTransformConstPointer( i ), parameters );
+			}
+			return;
+		}
+
+		const TransformBaseType::ParametersType & p = transform->GetParameters();
+		const TransformBaseType::ParametersType & f = transform->GetFixedParameters();
+		parameters.push_back( p.Size() );
+		parameters.insert( parameters.end(), p.begin(), p.end() );
+		parameters.push_back( f.Size() );
+		parameters.insert( parameters.end(), f.begin(), f.end() );
+		return;
 	}
 
 	template< typename TPixelType >
@@ -71,16 +135,19 @@ namespace itk
 		// perform functionality
 		if( this->m_ResampleImage )
 		{
-			this->m_TransformedImage = ResampleImage< typename ImageType >( this->m_MovingImage );
-			std::cout << "Moving image resampled." << std::endl;
-
-			// repeat for label map with nearest neighbor interpolation
 			if( m_MovingLabelMap )
 			{
-				NearestNeighborInterpolateOn();
-				this->m_TransformedLabelMap = ResampleImage< MaskImageType >( this->m_MovingLabelMap );
-				NearestNeighborInterpolateOff();
-				std::cout << "Moving label map resampled." << std::endl;
+				// resample image and label map together to share the mapped coordinates
+				const TransformBaseType * transform = m_CompositeTransform->IsTransformQueueEmpty() ?
+					static_cast< const TransformBaseType * >( m_InitialTransform.GetPointer() ) :
+					static_cast< const TransformBaseType * >( m_CompositeTransform.GetPointer() );
+				ResampleImageAndLabelMap( this->m_MovingImage, this->m_MovingLabelMap, transform, this->m_TransformedImage, this->m_TransformedLabelMap );
+				std::cout << "Moving image and label map resampled." << std::endl;
+			}
+			else
+			{
+				this->m_TransformedImage = ResampleImage< typename ImageType >( this->m_MovingImage );
+				std::cout << "Moving image resampled." << std::endl;
 			}
 		}
 		if( this->m_HardenTransform )
@@ -89,80 +156,137 @@ namespace itk
 		}
 		if( this->m_CropImage )
 		{
-			this->m_MovingCroppedImage = CropImage< typename ImageType >( this->m_TransformedImage );
-			this->m_FixedCroppedImage = CropImage< typename ImageType >(this->m_FixedImage);
-			std::cout << "Images cropped." << std::endl;
-			if( m_MovingLabelMap ) 
-			{ 
-				this->m_MovingCroppedLabelMap = CropImage< MaskImageType >( this->m_TransformedLabelMap );
-				std::cout << "Moving label map cropped." << std::endl;
-			} 
-			if( m_FixedLabelMap ) 
-			{ 
-				this->m_FixedCroppedLabelMap = CropImage< MaskImageType >( this->m_FixedLabelMap );
-				std::cout << "Fixed label map cropped." << std::endl;
-			}
+			// registration uses the full images limited to the ROI, so nothing is copied
+			this->m_FixedCropRegion = ComputeCropRegion< ImageType >( this->m_FixedImage );
+			std::cout << "ROI region computed: " << this->m_FixedCropRegion.GetIndex() << " " << this->m_FixedCropRegion.GetSize() << std::endl;
 		}
 
 		return;
 	}
 
+	// resample the image and label map through one transform, computing each mapped point once
+	template< typename TPixelType >
+	void ManageTransformsFilter< TPixelType >::ResampleImageAndLabelMap(typename ImageType::Pointer image, MaskImageType::Pointer labelMap, const TransformBaseType * transform,
+		typename ImageType::Pointer & outputImage, MaskImageType::Pointer & outputLabelMap)
+	{
+		if( !this->m_FixedImage )
+		{
+			itkExceptionMacro( << "FixedImage not present" );
+		}
+
+		// reuse previous resamples of the same image and label map with the same transform
+		ResampleCacheKey imageKey = CreateResampleCacheKey( image.GetPointer(), transform, false );
+		ResampleCacheKey labelMapKey = CreateResampleCacheKey( labelMap.GetPointer(), transform, true );
+		DataObject::Pointer cachedImage = FindResampleCache( imageKey );
+		DataObject::Pointer cachedLabelMap = FindResampleCache( labelMapKey );
+		if( cachedImage && cachedLabelMap )
+		{
+			outputImage = static_cast< ImageType * >( cachedImage.GetPointer() );
+			outputLabelMap = static_cast< MaskImageType * >( cachedLabelMap.GetPointer() );
+			return;
+		}
+
+		// only one of them is cached: resample the other on its own
+		if( cachedImage )
+		{
+			outputImage = static_cast< ImageType * >( cachedImage.GetPointer() );
+			outputLabelMap = ResampleImageWithTransform< MaskImageType >( labelMap, transform, true );
+			return;
+		}
+		if( cachedLabelMap )
+		{
+			outputImage = ResampleImageWithTransform< ImageType >( image, transform, false );
+			outputLabelMap = static_cast< MaskImageType * >( cachedLabelMap.GetPointer() );
+			return;
+		}
+
+		typedef itk::ResampleImageAndLabelMapFilter< TPixelType > FusedResampleFilterType;
+		typename FusedResampleFilterType::Pointer resample = FusedResampleFilterType::New();
+		resample->SetReferenceImage( this->m_FixedImage );
+		resample->SetImage( image );
+		resample->SetLabelMap( labelMap );
+		resample->SetTransform( transform );
+		resample->Update();
+
+		outputImage = resample->GetOutputImage();
+		outputLabelMap = resample->GetOutputLabelMap();
+		AddToResampleCache( imageKey, outputImage );
+		AddToResampleCache( labelMapKey, outputLabelMap );
+		return;
+	}
+
+	// look up a resampled image (null if not cached)
+	template< typename TPixelType >
+	DataObject::Pointer ManageTransformsFilter< TPixelType >::FindResampleCache(const ResampleCacheKey & key)
+	{
+		DataObject::Pointer image;
+		m_ResampleCacheLock.Lock();
+		typename std::map< ResampleCacheKey, DataObject::Pointer >::const_iterator it = m_ResampleCache.find( key );
+		if( it != m_ResampleCache.end() )
+		{
+			image = it->second;
+		}
+		m_ResampleCacheLock.Unlock();
+		return image;
+	}
+
+	template< typename TPixelType >
+	void ManageTransformsFilter< TPixelType >::AddToResampleCache(const ResampleCacheKey & key, DataObject * image)
+	{
+		m_ResampleCacheLock.Lock();
+		m_ResampleCache[key] = image;
+		m_ResampleCacheLock.Unlock();
+		return;
+	}
+
 	// apply current transform on file to the header information of the input image
 	template< typename TPixelType >
 	void ManageTransformsFilter< typename TPixelType >::HardenTransform()
 	{
-		// get image properties
-		/*ImageType::PointType origin = this->movingImage->GetOrigin();
-		ImageType::SpacingType spacing = this->movingImage->GetSpacing();
-		ImageType::DirectionType direction = this->movingImage->GetDirection();
-
-		// print out old parameters
-		std::cout << "OLD PARAMETERS" << std::endl;
-		std::cout << "Origin: [" << origin[0] << ", " << origin[1] << ", " << origin[2] << "]" << std::endl;
-		std::cout << "Spacing: [" << spacing[0] << ", " << spacing[1] << ", " << spacing[2] << "]" << std::endl;
-		std::cout << "Direction: [" << *direction[0] << ", " << *direction[1] << ", " << *direction[2] << std::endl;
-		std::cout << "            " << *direction[3] << ", " << *direction[4] << ", " << *direction[5] << std::endl;
-		std::cout << "            " << *direction[6] << ", " << *direction[7] << ", " << *direction[8] << "]" << std::endl;
-
-		// get transform parameters
-		TransformType::TranslationType translation = this->m_compositeTransform->GetTranslation();
-		TransformType::ScaleVectorType scale = this->m_compositeTransform->GetScale();
-		TransformType::VersorType versor = this->m_compositeTransform->GetVersor();
-
-		// apply parameters to image
-		for( int i = 0; i < 3; i++ )
+		const TransformBaseType * transform = m_CompositeTransform->IsTransformQueueEmpty() ?
+			static_cast< const TransformBaseType * >( m_InitialTransform.GetPointer() ) :
+			static_cast< const TransformBaseType * >( m_CompositeTransform.GetPointer() );
+
+		// collapse into a single matrix and offset: T(x) = Mx + o
+		typedef itk::LinearTransformResampleImageFilter< ImageType > LinearResampleType;
+		typename LinearResampleType::MatrixType matrix;
+		typename LinearResampleType::OffsetType offset;
+		bool hardenable = LinearResampleType::CollapseTransform( transform, matrix, offset ) &&
+			vnl_determinant( matrix.GetVnlMatrix() ) > 0;
+
+		// rotation and scaling are written into the header, shearing of the voxel axes is not possible
+		typename ImageType::PointType origin;
+		typename ImageType::DirectionType direction;
+		typename ImageType::SpacingType spacing;
+		typename MaskImageType::PointType labelMapOrigin;
+		typename MaskImageType::DirectionType labelMapDirection;
+		typename MaskImageType::SpacingType labelMapSpacing;
+		TransformMatrixType inverse;
+		if( hardenable )
+		{
+			inverse = matrix.GetInverse();
+			hardenable = HardenedGeometry< ImageType >( this->m_MovingImage, inverse, offset, origin, direction, spacing ) &&
+				( !m_MovingLabelMap || HardenedGeometry< MaskImageType >( this->m_MovingLabelMap, inverse, offset, labelMapOrigin, labelMapDirection, labelMapSpacing ) );
+		}
+		if( !hardenable )
+		{
+			std::cout << "Transform shears the image axes. Resampling instead of hardening." << std::endl;
+			this->m_TransformedImage = ResampleImage< ImageType >( this->m_MovingImage );
+			if( m_MovingLabelMap )
+			{
+				NearestNeighborInterpolateOn();
+				this->m_TransformedLabelMap = ResampleImage< MaskImageType >( this->m_MovingLabelMap );
+				NearestNeighborInterpolateOff();
+			}
+			return;
+		}
+
+		this->m_TransformedImage = HardenImage< ImageType >( this->m_MovingImage, origin, direction, spacing );
+		if( m_MovingLabelMap )
 		{
-			spacing[i] *= scale[i];
-			origin[i] += translation[i]*scale[i];
+			this->m_TransformedLabelMap = HardenImage< MaskImageType >( this->m_MovingLabelMap, labelMapOrigin, labelMapDirection, labelMapSpacing );
 		}
 
-		// apply rotation to image
-		ImageType::DirectionType newDirection = direction*versor.GetMatrix();
-	
-		std::cout << "\nNEW PARAMETERS" << std::endl;
-		std::cout << "Origin: [" << origin[0] << ", " << origin[1] << ", " << origin[2] << "]" << std::endl;
-		std::cout << "Spacing: [" << spacing[0] << ", " << spacing[1] << ", " << spacing[2] << "]" << std::endl;
-		std::cout << "Direction: [" << *direction[0] << ", " << *direction[1] << ", " << *direction[2] << std::endl;
-		std::cout << "            " << *direction[3] << ", " << *direction[4] << ", " << *direction[5] << std::endl;
-		std::cout << "            " << *direction[6] << ", " << *direction[7] << ", " << *direction[8] << "]" << std::endl;
-
-		// allocate hardening filter
-		typedef itk::ChangeInformationImageFilter< ImageType > HardenTransformFilter;
-		HardenTransformFilter::Pointer harden = HardenTransformFilter::New();
-		harden->SetInput( this->m_movingImage );
-
-		// set new parameters
-		harden->SetOutputSpacing( spacing );
-		harden->SetOutputOrigin( origin );
-		harden->SetOutputDirection( newDirection );
-
-		// turn change flags on
-		harden->ChangeSpacingOn();
-		harden->ChangeOriginOn();
-		harden->ChangeDirectionOn();
-
-		harden->Update();
-		this->m_transformedImage = harden->GetOutput();*/
 		std::cout << "Transform hardened." << std::endl;
 		return; 
 	}
@@ -359,6 +483,25 @@ namespace itk
 		return extract->GetOutput();
 	}*/
 
+	// convert the ROI [ centerx, centery, centerz, radiusx, radiusy, radiusz ] (RAS) to LPS corners
+	template< typename TPixelType >
+	void ManageTransformsFilter< TPixelType >::ComputeROIPoints()
+	{
+		std::vector<float>::iterator it = m_ROI.begin();
+
+		// extract center and radius
+		double c[3] = { -*(it), -*(it + 1), *(it + 2) };
+		double r[3] = { *(it + 3), *(it + 4), *(it + 5) };
+
+		for( int i = 0; i < 3; ++i )
+		{
+			m_ROIStartPoint[i] = c[i] - r[i];
+			m_ROIEndPoint[i] = c[i] + r[i];
+		}
+
+		return;
+	}
+
 	// extract point values from the slicer ROI file
 	template< typename TPixelType >
 	void ManageTransformsFilter< TPixelType >::ExtractROIPoints()
@@ -0,0 +1,70 @@
+/*
+Purpose: This class is a pixel container whose buffer is a memory-mapped region of a file. The file
+is mapped copy-on-write, so pages are read from disk only when they are first accessed and writes
+(e.g. in-place preprocessing) go to private copies of the touched pages; the file is never modified.
+The mapping is released when the container is destroyed. Used by ReadInImage for uncompressed
+images whose pixel type already matches the requested image type.
+
+*/
+
+#ifndef __itkMemoryMappedImageContainer_h
+#define __itkMemoryMappedImageContainer_h
+
+// include files
+#include "itkImportImageContainer.h"
+
+#include <string>
+
+namespace itk
+{
+// class MemoryMappedImageContainer
+template< typename TElementIdentifier, typename TElement >
+class MemoryMappedImageContainer: public ImportImageContainer< TElementIdentifier, TElement >
+{
+public:
+	// default ITK
+	typedef MemoryMappedImageContainer							Self;
+	typedef ImportImageContainer< TElementIdentifier, TElement >	Superclass;
+	typedef SmartPointer< Self >								Pointer;
+	typedef SmartPointer< const Self >							ConstPointer;
+
+	// definitions
+	typedef TElementIdentifier	ElementIdentifier;
+	typedef TElement			Element;
+
+	// method for creation
+	itkNewMacro(Self);
+
+	// run-time type information and related methods
+	itkTypeMacro(MemoryMappedImageContainer, ImportImageContainer);
+
+	// map numberOfElements elements starting at byte offset of the file
+	// (returns false if the file cannot be mapped or offset is not a multiple of the element size)
+	bool MapFile( const std::string & filename, SizeValueType offset, ElementIdentifier numberOfElements );
+
+protected:
+	// constructor
+	MemoryMappedImageContainer();
+
+	// destructor
+	virtual ~MemoryMappedImageContainer();
+
+private:
+	// release the current mapping
+	void UnmapFile();
+
+	// start and length of the mapped view (page aligned)
+	void * m_MappedAddress;
+	SizeValueType m_MappedLength;
+#ifdef _WIN32
+	void * m_FileHandle;
+	void * m_MappingHandle;
+#endif
+};
+} // end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkMemoryMappedImageContainer.hxx"
+#endif
+
+#endif
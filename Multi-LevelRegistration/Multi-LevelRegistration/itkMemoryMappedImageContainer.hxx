@@ -0,0 +1,148 @@
+#ifndef __itkMemoryMappedImageContainer_hxx
+#define __itkMemoryMappedImageContainer_hxx
+
+#include "itkMemoryMappedImageContainer.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace itk
+{
+	// constructor
+	template< typename TElementIdentifier, typename TElement >
+	MemoryMappedImageContainer< TElementIdentifier, TElement >::MemoryMappedImageContainer():
+		m_MappedAddress( ITK_NULLPTR ),
+		m_MappedLength( 0 )
+#ifdef _WIN32
+		, m_FileHandle( ITK_NULLPTR ),
+		m_MappingHandle( ITK_NULLPTR )
+#endif
+	{}
+
+	// destructor
+	template< typename TElementIdentifier, typename TElement >
+	MemoryMappedImageContainer< TElementIdentifier, TElement >::~MemoryMappedImageContainer()
+	{
+		UnmapFile();
+	}
+
+	template< typename TElementIdentifier, typename TElement >
+	bool MemoryMappedImageContainer< TElementIdentifier, TElement >::MapFile( const std::string & filename, SizeValueType offset, ElementIdentifier numberOfElements )
+	{
+		UnmapFile();
+
+		// elements must be aligned in the view (the view itself is page aligned)
+		if( offset % sizeof( Element ) != 0 )
+		{
+			return false;
+		}
+
+		const SizeValueType numberOfBytes = static_cast< SizeValueType >( numberOfElements )*sizeof( Element );
+
+#ifdef _WIN32
+		// views must start at a multiple of the allocation granularity
+		SYSTEM_INFO info;
+		GetSystemInfo( &info );
+		const SizeValueType alignedOffset = offset - offset % info.dwAllocationGranularity;
+
+		HANDLE file = CreateFileA( filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL );
+		if( file == INVALID_HANDLE_VALUE )
+		{
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if( !GetFileSizeEx( file, &fileSize ) || static_cast< SizeValueType >( fileSize.QuadPart ) < offset + numberOfBytes )
+		{
+			CloseHandle( file );
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+		if( mapping == NULL )
+		{
+			CloseHandle( file );
+			return false;
+		}
+		const SizeValueType length = numberOfBytes + ( offset - alignedOffset );
+		void * address = MapViewOfFile( mapping, FILE_MAP_COPY,
+			static_cast< DWORD >( static_cast< unsigned long long >( alignedOffset ) >> 32 ), static_cast< DWORD >( alignedOffset & 0xFFFFFFFF ), length );
+		if( address == NULL )
+		{
+			CloseHandle( mapping );
+			CloseHandle( file );
+			return false;
+		}
+		this->m_FileHandle = file;
+		this->m_MappingHandle = mapping;
+#else
+		// views must start at a multiple of the page size
+		const SizeValueType pageSize = static_cast< SizeValueType >( sysconf( _SC_PAGESIZE ) );
+		const SizeValueType alignedOffset = offset - offset % pageSize;
+
+		const int file = open( filename.c_str(), O_RDONLY );
+		if( file < 0 )
+		{
+			return false;
+		}
+		struct stat status;
+		if( fstat( file, &status ) != 0 || static_cast< SizeValueType >( status.st_size ) < offset + numberOfBytes )
+		{
+			close( file );
+			return false;
+		}
+		const SizeValueType length = numberOfBytes + ( offset - alignedOffset );
+		void * address = mmap( ITK_NULLPTR, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, static_cast< off_t >( alignedOffset ) );
+		close( file );	// the mapping keeps its own reference to the file
+		if( address == MAP_FAILED )
+		{
+			return false;
+		}
+#endif
+
+		this->m_MappedAddress = address;
+		this->m_MappedLength = length;
+
+		// the container points into the view but does not own it
+		Element * data = reinterpret_cast< Element * >( static_cast< char * >( address ) + ( offset - alignedOffset ) );
+		this->SetImportPointer( data, numberOfElements, false );
+
+		return true;
+	}
+
+	template< typename TElementIdentifier, typename TElement >
+	void MemoryMappedImageContainer< TElementIdentifier, TElement >::UnmapFile()
+	{
+		if( !this->m_MappedAddress )
+		{
+			return;
+		}
+
+		// drop the pointer into the view before releasing it
+		this->SetImportPointer( ITK_NULLPTR, 0, false );
+
+#ifdef _WIN32
+		UnmapViewOfFile( this->m_MappedAddress );
+		CloseHandle( static_cast< HANDLE >( this->m_MappingHandle ) );
+		CloseHandle( static_cast< HANDLE >( this->m_FileHandle ) );
+		this->m_MappingHandle = ITK_NULLPTR;
+		this->m_FileHandle = ITK_NULLPTR;
+#else
+		munmap( this->m_MappedAddress, this->m_MappedLength );
+#endif
+
+		this->m_MappedAddress = ITK_NULLPTR;
+		this->m_MappedLength = 0;
+		return;
+	}
+
+} // end namespace
+
+#endif
@@ -0,0 +1,88 @@
+/*
+Purpose: This class writes a 3D image as a gzip-encoded NRRD file, compressing the image in slabs of
+slices on all threads. Every slab is compressed as an independent gzip member and the members are
+written one after the other, which is a valid gzip stream (RFC 1952 allows concatenated members), so
+the output is a standard NRRD (encoding: gzip) that ITK, Slicer, teem and gunzip read as usual.
+
+*/
+
+#ifndef __itkParallelCompressedImageWriter_h
+#define __itkParallelCompressedImageWriter_h
+
+// include files
+#include "itkImage.h"
+#include "itkMultiThreader.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+// class ParallelCompressedImageWriter
+template< typename TImageType >
+class ParallelCompressedImageWriter: public Object
+{
+public:
+	// default ITK
+	typedef ParallelCompressedImageWriter	Self;
+	typedef Object							Superclass;
+	typedef SmartPointer< Self >			Pointer;
+	typedef SmartPointer< const Self >		ConstPointer;
+
+	// definitions
+	typedef TImageType							ImageType;
+	typedef typename ImageType::PixelType		PixelType;
+
+	// method for creation
+	itkNewMacro(Self);
+
+	// run-time type information and related methods
+	itkTypeMacro(ParallelCompressedImageWriter, Object);
+
+	// set inputs
+	itkSetConstObjectMacro( Input, ImageType );
+	itkSetMacro( FileName, std::string );
+
+	// number of slices compressed together (default 4)
+	itkSetMacro( SlicesPerSlab, unsigned int );
+
+	// zlib compression level 1 (fastest) - 9 (smallest), default 1
+	itkSetMacro( CompressionLevel, int );
+
+	// perform function
+	void Update();
+
+protected:
+	// constructor
+	ParallelCompressedImageWriter();
+
+	// destructor
+	virtual ~ParallelCompressedImageWriter() {}
+
+private:
+	// inputs
+	typename ImageType::ConstPointer m_Input;
+	std::string m_FileName;
+	unsigned int m_SlicesPerSlab;
+	int m_CompressionLevel;
+
+	// compressed slabs in file order
+	std::vector< std::vector< unsigned char > > m_CompressedSlabs;
+	std::atomic< bool > m_CompressionFailed;	// set from any compressing thread
+
+	// header
+	std::string CreateHeader() const;
+	static std::string GetNrrdType();
+
+	// threading
+	static ITK_THREAD_RETURN_TYPE ThreaderCallback( void * arg );
+	void ThreadedCompress( unsigned int threadId, unsigned int numberOfThreads );
+};
+} // end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkParallelCompressedImageWriter.hxx"
+#endif
+
+#endif
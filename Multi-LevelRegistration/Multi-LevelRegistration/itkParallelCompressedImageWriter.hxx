@@ -0,0 +1,199 @@
+#ifndef __itkParallelCompressedImageWriter_hxx
+#define __itkParallelCompressedImageWriter_hxx
+
+#include "itkParallelCompressedImageWriter.h"
+#include "itkByteSwapper.h"
+#include "itk_zlib.h"
+
+#include <fstream>
+#include <sstream>
+#include <typeinfo>
+
+namespace itk
+{
+	// constructor
+	template< typename TImageType >
+	ParallelCompressedImageWriter< TImageType >::ParallelCompressedImageWriter():
+		m_Input( ITK_NULLPTR ),	// defined by user
+		m_FileName( "" ),		// defined by user
+		m_SlicesPerSlab( 4 ),
+		m_CompressionLevel( 1 ),
+		m_CompressionFailed( false )
+	{}
+
+	template< typename TImageType >
+	void ParallelCompressedImageWriter< TImageType >::Update()
+	{
+		// error checking
+		if( !m_Input )
+		{
+			itkExceptionMacro( << "Input image not present" );
+		}
+		if( m_FileName.empty() )
+		{
+			itkExceptionMacro( << "Filename not present" );
+		}
+		if( m_Input->GetBufferedRegion() != m_Input->GetLargestPossibleRegion() )
+		{
+			itkExceptionMacro( << "The whole image must be in memory" );
+		}
+
+		// compress slabs on all threads
+		const unsigned int numberOfSlices = m_Input->GetBufferedRegion().GetSize()[2];
+		const unsigned int slicesPerSlab = std::max( 1u, m_SlicesPerSlab );
+		this->m_CompressedSlabs.assign( ( numberOfSlices + slicesPerSlab - 1 ) / slicesPerSlab, std::vector< unsigned char >() );
+		this->m_CompressionFailed = false;
+
+		MultiThreader::Pointer threader = MultiThreader::New();
+		threader->SetSingleMethod( this->ThreaderCallback, this );
+		threader->SingleMethodExecute();
+
+		if( this->m_CompressionFailed )
+		{
+			this->m_CompressedSlabs.clear();
+			itkExceptionMacro( << "Compression failed" );
+		}
+
+		// write the header and the gzip members in order
+		std::ofstream file( m_FileName.c_str(), std::ios::out | std::ios::binary );
+		if( !file )
+		{
+			this->m_CompressedSlabs.clear();
+			itkExceptionMacro( << "Could not open " << m_FileName << " for writing" );
+		}
+		const std::string header = CreateHeader();
+		file.write( header.c_str(), header.size() );
+		for( unsigned int i = 0; i < this->m_CompressedSlabs.size(); ++i )
+		{
+			if( !this->m_CompressedSlabs[i].empty() )
+			{
+				file.write( reinterpret_cast< const char * >( &this->m_CompressedSlabs[i][0] ), this->m_CompressedSlabs[i].size() );
+			}
+		}
+		file.close();
+		this->m_CompressedSlabs.clear();
+
+		if( file.fail() )
+		{
+			itkExceptionMacro( << "Could not write " << m_FileName );
+		}
+
+		return;
+	}
+
+	template< typename TImageType >
+	ITK_THREAD_RETURN_TYPE ParallelCompressedImageWriter< TImageType >::ThreaderCallback( void * arg )
+	{
+		MultiThreader::ThreadInfoStruct * info = static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+		Self * self = static_cast< Self * >( info->UserData );
+		self->ThreadedCompress( info->ThreadID, info->NumberOfThreads );
+		return ITK_THREAD_RETURN_VALUE;
+	}
+
+	// compress every numberOfThreads-th slab as its own gzip member
+	template< typename TImageType >
+	void ParallelCompressedImageWriter< TImageType >::ThreadedCompress( unsigned int threadId, unsigned int numberOfThreads )
+	{
+		const typename ImageType::SizeType size = m_Input->GetBufferedRegion().GetSize();
+		const SizeValueType sliceBytes = size[0]*size[1]*sizeof( PixelType );
+		const unsigned int numberOfSlices = size[2];
+		const unsigned int slicesPerSlab = std::max( 1u, m_SlicesPerSlab );
+		const unsigned char * buffer = reinterpret_cast< const unsigned char * >( m_Input->GetBufferPointer() );
+
+		for( unsigned int slab = threadId; slab < this->m_CompressedSlabs.size(); slab += numberOfThreads )
+		{
+			const unsigned int firstSlice = slab*slicesPerSlab;
+			const unsigned int lastSlice = std::min( numberOfSlices, firstSlice + slicesPerSlab );
+			const SizeValueType numberOfBytes = ( lastSlice - firstSlice )*sliceBytes;
+
+			// windowBits 15 + 16 writes a gzip header and trailer
+			z_stream stream;
+			stream.zalloc = Z_NULL;
+			stream.zfree = Z_NULL;
+			stream.opaque = Z_NULL;
+			if( deflateInit2( &stream, m_CompressionLevel, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+			{
+				this->m_CompressionFailed = true;
+				return;
+			}
+
+			std::vector< unsigned char > & output = this->m_CompressedSlabs[slab];
+			output.resize( deflateBound( &stream, static_cast< uLong >( numberOfBytes ) ) );
+			stream.next_in = const_cast< Bytef * >( buffer + firstSlice*sliceBytes );
+			stream.avail_in = static_cast< uInt >( numberOfBytes );
+			stream.next_out = &output[0];
+			stream.avail_out = static_cast< uInt >( output.size() );
+			const int status = deflate( &stream, Z_FINISH );
+			output.resize( stream.total_out );
+			deflateEnd( &stream );
+
+			if( status != Z_STREAM_END )
+			{
+				this->m_CompressionFailed = true;
+				return;
+			}
+		}
+
+		return;
+	}
+
+	// NRRD header for gzip encoded data in LPS space
+	template< typename TImageType >
+	std::string ParallelCompressedImageWriter< TImageType >::CreateHeader() const
+	{
+		const typename ImageType::SizeType size = m_Input->GetLargestPossibleRegion().GetSize();
+		const typename ImageType::SpacingType spacing = m_Input->GetSpacing();
+		const typename ImageType::DirectionType direction = m_Input->GetDirection();
+		const typename ImageType::PointType origin = m_Input->GetOrigin();
+
+		std::ostringstream header;
+		header.precision( 17 );
+		header << "NRRD0004" << "\n";
+		header << "# Complete NRRD file format specification at:" << "\n";
+		header << "# http://teem.sourceforge.net/nrrd/format.html" << "\n";
+		header << "type: " << GetNrrdType() << "\n";
+		header << "dimension: 3" << "\n";
+		header << "space: left-posterior-superior" << "\n";
+		header << "sizes: " << size[0] << " " << size[1] << " " << size[2] << "\n";
+		header << "space directions:";
+		for( unsigned int c = 0; c < 3; ++c )
+		{
+			header << " (" << direction[0][c]*spacing[c] << "," << direction[1][c]*spacing[c] << "," << direction[2][c]*spacing[c] << ")";
+		}
+		header << "\n";
+		header << "kinds: domain domain domain" << "\n";
+		if( sizeof( PixelType ) > 1 )
+		{
+			header << "endian: " << ( ByteSwapper< PixelType >::SystemIsBigEndian() ? "big" : "little" ) << "\n";
+		}
+		header << "encoding: gzip" << "\n";
+		header << "space origin: (" << origin[0] << "," << origin[1] << "," << origin[2] << ")" << "\n";
+		header << "\n";
+
+		return header.str();
+	}
+
+	template< typename TImageType >
+	std::string ParallelCompressedImageWriter< TImageType >::GetNrrdType()
+	{
+		const bool isSigned = NumericTraits< PixelType >::is_signed;
+		if( !NumericTraits< PixelType >::is_integer )
+		{
+			return sizeof( PixelType ) == 4 ? "float" : "double";
+		}
+		switch( sizeof( PixelType ) )
+		{
+		case 1:
+			return isSigned ? "int8" : "uint8";
+		case 2:
+			return isSigned ? "int16" : "uint16";
+		case 4:
+			return isSigned ? "int32" : "uint32";
+		default:
+			return isSigned ? "int64" : "uint64";
+		}
+	}
+
+} // end namespace
+
+#endif
@@ -25,6 +25,7 @@ Remaining to implement:
 #include "itkLinearInterpolateImageFunction.h"
 #include "itkMattesMutualInformationImageToImageMetric.h"
 #include "itkImageRegistrationMethod.h"
+#include "itkBoxSpatialObject.h"
 #include "RigidCommandIterationUpdate.h"
 
 namespace itk
@@ -62,6 +63,15 @@ public:
 	itkSetObjectMacro( MovingImage, ImageType );
 	itkSetObjectMacro( InitialTransform, TransformType );
 
+	// limit registration to a region of the full images (no cropped copies)
+	void SetFixedImageRegion( const typename ImageType::RegionType & region )
+	{
+		this->m_FixedImageRegion = region;
+		this->m_UseFixedImageRegion = true;
+		return;
+	}
+	void SetMovingImageROI( const typename ImageType::PointType & startPoint, const typename ImageType::PointType & endPoint );
+
 	// set variables that might want to change
 	itkSetMacro( MinimumStepLength, float );
 	itkSetMacro( MaximumStepLength, float );
@@ -73,6 +83,9 @@ public:
 	itkSetMacro( ScalingScale, float );
 	itkSetMacro( DebugDirectory, std::string );
 
+	// threads used by the metric (0: ITK default), for registrations that run side by side
+	itkSetMacro( NumberOfThreads, unsigned int );
+
 	// observer
 	void ObserveOn()
 	{
@@ -94,6 +107,11 @@ public:
 		this->m_DebugOn = false;
 		return;
 	}
+	void AddIterationObserver( itk::Command * command )
+	{
+		this->m_Optimizer->AddObserver( itk::IterationEvent(), command );
+		return;
+	}
 
 	// get results
 	itkGetObjectMacro( FinalTransform, TransformType );
@@ -115,6 +133,12 @@ private:
 	// images
 	typename ImageType::Pointer m_FixedImage;
 	typename ImageType::Pointer m_MovingImage;
+	typename ImageType::RegionType m_FixedImageRegion;
+	bool m_UseFixedImageRegion;
+
+	// moving image mask limited to the ROI
+	typedef itk::BoxSpatialObject< 3 >	MovingImageMaskType;
+	MovingImageMaskType::Pointer m_MovingImageMask;
 
 	// transforms
 	TransformType::Pointer m_FinalTransform;
@@ -147,6 +171,7 @@ private:
 	typename MetricType::Pointer m_Metric;
 	float m_PercentageOfSamples;
 	int m_HistogramBins;
+	unsigned int m_NumberOfThreads;
 
 	// private functions
 	void Initialize();
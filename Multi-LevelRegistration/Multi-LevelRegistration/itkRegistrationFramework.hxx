@@ -11,6 +11,8 @@ namespace itk
 		// images
 		m_FixedImage(ITK_NULLPTR),	// provided by user
 		m_MovingImage(ITK_NULLPTR),	// provided by user
+		m_UseFixedImageRegion(false),
+		m_MovingImageMask(ITK_NULLPTR),	// provided by user
 
 		// transforms
 		m_InitialTransform(ITK_NULLPTR),	// provided by user
@@ -18,6 +20,7 @@ namespace itk
 		// metric
 		m_PercentageOfSamples(0.01),
 		m_HistogramBins(50),
+		m_NumberOfThreads(0),
 
 		// optimizer
 		m_MinimumStepLength(0.001),
@@ -59,7 +62,18 @@ namespace itk
 		// input images and transform to registration class
 		this->m_Registration->SetFixedImage( this->m_FixedImage );
 		this->m_Registration->SetMovingImage( this->m_MovingImage );
-		this->m_Registration->SetFixedImageRegion( this->m_FixedImage->GetBufferedRegion() );
+		if( this->m_UseFixedImageRegion )
+		{
+			this->m_Registration->SetFixedImageRegion( this->m_FixedImageRegion );
+		}
+		else
+		{
+			this->m_Registration->SetFixedImageRegion( this->m_FixedImage->GetBufferedRegion() );
+		}
+		if( this->m_MovingImageMask )
+		{
+			this->m_Metric->SetMovingImageMask( this->m_MovingImageMask );
+		}
 		
 		// initial transform
 		TransformType::ParametersType identityParameters( this->m_Transform->GetNumberOfParameters() );
@@ -110,6 +124,27 @@ namespace itk
 		return;
 	}
 
+	// restrict moving image samples to the physical ROI box
+	template< typename TPixelType >
+	void RegistrationFramework< TPixelType >::SetMovingImageROI( const typename ImageType::PointType & startPoint, const typename ImageType::PointType & endPoint )
+	{
+		this->m_MovingImageMask = MovingImageMaskType::New();
+
+		// box is defined from its lower corner in object space
+		MovingImageMaskType::SizeType boxSize;
+		MovingImageMaskType::TransformType::OffsetType offset;
+		for( int i = 0; i < 3; ++i )
+		{
+			boxSize[i] = std::abs( endPoint[i] - startPoint[i] );
+			offset[i] = std::min( startPoint[i], endPoint[i] );
+		}
+		this->m_MovingImageMask->SetSize( boxSize );
+		this->m_MovingImageMask->GetObjectToParentTransform()->SetOffset( offset );
+		this->m_MovingImageMask->ComputeObjectToWorldTransform();
+
+		return;
+	}
+
 	// set up MMI metric for defaults
 	template< typename TPixelType >
 	void RegistrationFramework< TPixelType >::Initialize()
@@ -126,11 +161,15 @@ namespace itk
 
 		// ****SET UP METRIC****
 		// determine number of samples to use
-		ImageType::SizeType size = this->m_FixedImage->GetLargestPossibleRegion().GetSize();
+		ImageType::SizeType size = this->m_UseFixedImageRegion ? this->m_FixedImageRegion.GetSize() : this->m_FixedImage->GetLargestPossibleRegion().GetSize();
 		int NumOfPixels = size[0]*size[1]*size[2];
 		this->m_Metric->SetNumberOfSpatialSamples( NumOfPixels*(this->m_PercentageOfSamples) );
 		// define number of histogram bins
 		this->m_Metric->SetNumberOfHistogramBins( this->m_HistogramBins );
+		if( this->m_NumberOfThreads > 0 )
+		{
+			this->m_Metric->SetNumberOfThreads( this->m_NumberOfThreads );
+		}
 
 
 		// ****SET UP OPTIMIZER****
@@ -168,7 +207,8 @@ namespace itk
 		if (this->m_DebugOn)
 		{
 			this->m_Observer->Debug(this->m_DebugDirectory);
-			std::cout << "Writing out every 50 iterations" << std::endl;
+			this->m_Observer->SetFixedParameters(this->m_Transform->GetFixedParameters());
+			std::cout << "Logging every iteration to the transform history" << std::endl;
 		}
 		if ((this->m_ObserveOn || this->m_DebugOn) && this->m_ObserverSet)
 		{
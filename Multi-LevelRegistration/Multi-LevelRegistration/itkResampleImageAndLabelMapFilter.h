@@ -0,0 +1,91 @@
+/*
+Purpose: This class resamples an intensity image and its corresponding label map into the
+space of a reference image in a single pass. The mapped point of each output voxel is computed
+once through the transform and then used by both a linear interpolator (image) and a nearest
+neighbor interpolator (label map). This replaces two separate ResampleImageFilter passes that
+recompute the same mapped coordinates.
+
+*/
+
+#ifndef __itkResampleImageAndLabelMapFilter_h
+#define __itkResampleImageAndLabelMapFilter_h
+
+// include files
+#include "itkImage.h"
+#include "itkTransform.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
+#include "itkMultiThreader.h"
+
+namespace itk
+{
+// class ResampleImageAndLabelMapFilter
+template< typename TPixelType >
+class ResampleImageAndLabelMapFilter: public Object
+{
+public:
+	// default ITK
+	typedef ResampleImageAndLabelMapFilter	Self;
+	typedef Object							Superclass;
+	typedef SmartPointer< Self >			Pointer;
+	typedef SmartPointer< const Self >		ConstPointer;
+
+	// definitions
+	typedef itk::Image< TPixelType, 3 >				ImageType;
+	typedef itk::Image< unsigned char, 3 >			MaskImageType;
+	typedef itk::Transform< double, 3, 3 >			TransformType;
+	typedef itk::LinearInterpolateImageFunction< ImageType, double >				LinearInterpolatorType;
+	typedef itk::NearestNeighborInterpolateImageFunction< MaskImageType, double >	NearestNeighborInterpolatorType;
+
+	// method for creation
+	itkNewMacro(Self);
+
+	// run-time type information and related methods
+	itkTypeMacro(ResampleImageAndLabelMapFilter, Object);
+
+	// set inputs
+	itkSetObjectMacro( ReferenceImage, ImageType );
+	itkSetObjectMacro( Image, ImageType );
+	itkSetObjectMacro( LabelMap, MaskImageType );
+	itkSetConstObjectMacro( Transform, TransformType );
+
+	// get results
+	itkGetObjectMacro( OutputImage, ImageType );
+	itkGetObjectMacro( OutputLabelMap, MaskImageType );
+
+	// perform function
+	void Update();
+
+protected:
+	// constructor
+	ResampleImageAndLabelMapFilter();
+
+	// destructor
+	virtual ~ResampleImageAndLabelMapFilter() {}
+
+private:
+	// inputs
+	typename ImageType::Pointer m_ReferenceImage;
+	typename ImageType::Pointer m_Image;
+	MaskImageType::Pointer m_LabelMap;
+	typename TransformType::ConstPointer m_Transform;
+
+	// outputs
+	typename ImageType::Pointer m_OutputImage;
+	MaskImageType::Pointer m_OutputLabelMap;
+
+	// interpolators
+	typename LinearInterpolatorType::Pointer m_LinearInterpolator;
+	typename NearestNeighborInterpolatorType::Pointer m_NearestNeighborInterpolator;
+
+	// threading
+	static ITK_THREAD_RETURN_TYPE ThreaderCallback( void * arg );
+	void ThreadedResample( unsigned int threadId, unsigned int numberOfThreads );
+};
+} // end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkResampleImageAndLabelMapFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef __itkResampleImageAndLabelMapFilter_hxx
+#define __itkResampleImageAndLabelMapFilter_hxx
+
+#include "itkResampleImageAndLabelMapFilter.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkNumericTraits.h"
+
+namespace itk
+{
+	// constructor
+	template< typename TPixelType >
+	ResampleImageAndLabelMapFilter< TPixelType >::ResampleImageAndLabelMapFilter():
+		m_ReferenceImage( ITK_NULLPTR ),	// defined by user
+		m_Image( ITK_NULLPTR ),	// defined by user
+		m_LabelMap( ITK_NULLPTR ),	// defined by user
+		m_Transform( ITK_NULLPTR )	// defined by user
+	{
+		m_LinearInterpolator = LinearInterpolatorType::New();
+		m_NearestNeighborInterpolator = NearestNeighborInterpolatorType::New();
+	}
+
+	template< typename TPixelType >
+	void ResampleImageAndLabelMapFilter< TPixelType >::Update()
+	{
+		// error checking
+		if( !m_ReferenceImage )
+		{
+			itkExceptionMacro( << "ReferenceImage not present" );
+		}
+		if( !m_Image && !m_LabelMap )
+		{
+			itkExceptionMacro( << "Neither Image nor LabelMap present" );
+		}
+		if( !m_Transform )
+		{
+			itkExceptionMacro( << "Transform not present" );
+		}
+
+		// allocate outputs in the space of the reference image
+		typename ImageType::RegionType region;
+		region.SetSize( this->m_ReferenceImage->GetLargestPossibleRegion().GetSize() );
+		region.SetIndex( this->m_ReferenceImage->GetLargestPossibleRegion().GetIndex() );
+		this->m_OutputImage = ITK_NULLPTR;
+		this->m_OutputLabelMap = ITK_NULLPTR;
+
+		if( m_Image )
+		{
+			this->m_OutputImage = ImageType::New();
+			this->m_OutputImage->SetRegions( region );
+			this->m_OutputImage->SetOrigin( this->m_ReferenceImage->GetOrigin() );
+			this->m_OutputImage->SetSpacing( this->m_ReferenceImage->GetSpacing() );
+			this->m_OutputImage->SetDirection( this->m_ReferenceImage->GetDirection() );
+			this->m_OutputImage->Allocate();
+			this->m_LinearInterpolator->SetInputImage( this->m_Image );
+		}
+		if( m_LabelMap )
+		{
+			this->m_OutputLabelMap = MaskImageType::New();
+			this->m_OutputLabelMap->SetRegions( region );
+			this->m_OutputLabelMap->SetOrigin( this->m_ReferenceImage->GetOrigin() );
+			this->m_OutputLabelMap->SetSpacing( this->m_ReferenceImage->GetSpacing() );
+			this->m_OutputLabelMap->SetDirection( this->m_ReferenceImage->GetDirection() );
+			this->m_OutputLabelMap->Allocate();
+			this->m_NearestNeighborInterpolator->SetInputImage( this->m_LabelMap );
+		}
+
+		// split the output slices across the available threads
+		MultiThreader::Pointer threader = MultiThreader::New();
+		threader->SetSingleMethod( this->ThreaderCallback, this );
+		threader->SingleMethodExecute();
+
+		return;
+	}
+
+	template< typename TPixelType >
+	ITK_THREAD_RETURN_TYPE ResampleImageAndLabelMapFilter< TPixelType >::ThreaderCallback( void * arg )
+	{
+		MultiThreader::ThreadInfoStruct * info = static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+		Self * self = static_cast< Self * >( info->UserData );
+		self->ThreadedResample( info->ThreadID, info->NumberOfThreads );
+		return ITK_THREAD_RETURN_VALUE;
+	}
+
+	template< typename TPixelType >
+	void ResampleImageAndLabelMapFilter< TPixelType >::ThreadedResample( unsigned int threadId, unsigned int numberOfThreads )
+	{
+		// determine the slab of slices handled by this thread
+		typename ImageType::RegionType region = this->m_ReferenceImage->GetLargestPossibleRegion();
+		const SizeValueType slices = region.GetSize()[2];
+		const SizeValueType slicesPerThread = ( slices + numberOfThreads - 1 ) / numberOfThreads;
+		const SizeValueType firstSlice = threadId * slicesPerThread;
+		if( firstSlice >= slices )
+		{
+			return;
+		}
+		const SizeValueType lastSlice = std::min( slices, firstSlice + slicesPerThread );
+		region.SetIndex( 2, region.GetIndex()[2] + firstSlice );
+		region.SetSize( 2, lastSlice - firstSlice );
+
+		// bounds used to cast the linear interpolation back into the pixel type
+		const double minPixel = static_cast< double >( NumericTraits< TPixelType >::NonpositiveMin() );
+		const double maxPixel = static_cast< double >( NumericTraits< TPixelType >::max() );
+
+		typedef ImageRegionConstIteratorWithIndex< ImageType >	ReferenceIteratorType;
+		typedef ImageRegionIterator< ImageType >				ImageIteratorType;
+		typedef ImageRegionIterator< MaskImageType >			LabelIteratorType;
+		ReferenceIteratorType rIt( this->m_ReferenceImage, region );
+		ImageIteratorType iIt;
+		LabelIteratorType lIt;
+		if( m_OutputImage ) { iIt = ImageIteratorType( this->m_OutputImage, region ); }
+		if( m_OutputLabelMap ) { lIt = LabelIteratorType( this->m_OutputLabelMap, region ); }
+
+		typename ImageType::PointType point;
+		typename ImageType::PointType mappedPoint;
+		typename LinearInterpolatorType::ContinuousIndexType imageIndex;
+		typename NearestNeighborInterpolatorType::ContinuousIndexType labelIndex;
+
+		for( rIt.GoToBegin(); !rIt.IsAtEnd(); ++rIt )
+		{
+			// compute the mapped point once for both outputs
+			this->m_ReferenceImage->TransformIndexToPhysicalPoint( rIt.GetIndex(), point );
+			mappedPoint = this->m_Transform->TransformPoint( point );
+
+			if( m_OutputImage )
+			{
+				double value = 0.0;
+				this->m_Image->TransformPhysicalPointToContinuousIndex( mappedPoint, imageIndex );
+				if( this->m_LinearInterpolator->IsInsideBuffer( imageIndex ) )
+				{
+					value = this->m_LinearInterpolator->EvaluateAtContinuousIndex( imageIndex );
+					value = std::max( minPixel, std::min( maxPixel, value ) );
+				}
+				iIt.Set( static_cast< TPixelType >( value ) );
+				++iIt;
+			}
+			if( m_OutputLabelMap )
+			{
+				unsigned char label = 0;
+				this->m_LabelMap->TransformPhysicalPointToContinuousIndex( mappedPoint, labelIndex );
+				if( this->m_NearestNeighborInterpolator->IsInsideBuffer( labelIndex ) )
+				{
+					label = static_cast< unsigned char >( this->m_NearestNeighborInterpolator->EvaluateAtContinuousIndex( labelIndex ) );
+				}
+				lIt.Set( label );
+				++lIt;
+			}
+		}
+
+		return;
+	}
+
+} // end namespace
+
+#endif
@@ -0,0 +1,113 @@
+/*
+Purpose: This class shares read-only images between the registrations of a batch so that an image
+used by several jobs (typically the fixed image) is read once. Reserve() is called once for every
+job that will use a file; the first Get() reads the image (other jobs asking for it meanwhile wait
+for that read) and Release() drops the image once the last job using it is done.
+
+NOTE: images from the cache are shared; a job that changes pixels must work on a copy.
+
+*/
+
+#ifndef __itkSharedImageCache_h
+#define __itkSharedImageCache_h
+
+// include files
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkDataObject.h"
+#include "itkImageIOBase.h"
+
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace itk
+{
+// class SharedImageCache
+class SharedImageCache: public Object
+{
+public:
+	// default ITK
+	typedef SharedImageCache			Self;
+	typedef Object						Superclass;
+	typedef SmartPointer< Self >		Pointer;
+	typedef SmartPointer< const Self >	ConstPointer;
+
+	// method for creation
+	itkNewMacro(Self);
+
+	// run-time type information and related methods
+	itkTypeMacro(SharedImageCache, Object);
+
+	// announce one more job that will use the file
+	void Reserve( const std::string & filename )
+	{
+		std::lock_guard< std::mutex > lock( m_Mutex );
+		++m_Entries[filename].users;
+	}
+
+	// a job is done with the file (the image is dropped after the last one)
+	void Release( const std::string & filename )
+	{
+		std::lock_guard< std::mutex > lock( m_Mutex );
+		std::map< std::string, EntryType >::iterator it = m_Entries.find( filename );
+		if( it != m_Entries.end() && --it->second.users == 0 )
+		{
+			m_Entries.erase( it );
+		}
+	}
+
+	// image of the file, read with ReadInImage on first use (io is an optional probed ImageIO)
+	// (ReadWriteFunctions.hxx has to be included before this header; ReadInImage returns images without
+	// a source, so jobs connecting the shared image to their own filters never update a common reader)
+	template< typename ImageType >
+	typename ImageType::Pointer Get( const std::string & filename, ImageIOBase * io = ITK_NULLPTR )
+	{
+		std::unique_lock< std::mutex > lock( m_Mutex );
+		EntryType & entry = m_Entries[filename];
+		if( entry.image.valid() )
+		{
+			std::shared_future< DataObject::Pointer > image = entry.image;
+			lock.unlock();
+			typename ImageType::Pointer shared = dynamic_cast< ImageType * >( image.get().GetPointer() );
+			if( shared )
+			{
+				return shared;
+			}
+
+			// same file with another pixel type is not shared
+			return ReadInImage< ImageType >( filename.c_str(), io );
+		}
+
+		// this job reads the image
+		std::promise< DataObject::Pointer > promise;
+		entry.image = promise.get_future().share();
+		lock.unlock();
+
+		typename ImageType::Pointer image = ReadInImage< ImageType >( filename.c_str(), io );
+		promise.set_value( DataObject::Pointer( image.GetPointer() ) );
+		return image;
+	}
+
+protected:
+	// constructor
+	SharedImageCache() {}
+
+	// destructor
+	virtual ~SharedImageCache() {}
+
+private:
+	struct EntryType
+	{
+		EntryType(): users( 0 ) {}
+		unsigned int users;
+		std::shared_future< DataObject::Pointer > image;
+	};
+
+	std::map< std::string, EntryType > m_Entries;
+	std::mutex m_Mutex;
+};
+} // end namespace
+
+#endif
@@ -0,0 +1,142 @@
+/*
+Purpose: This class estimates overlap measures between a fixed and a moving label map for a given
+transform without resampling the moving label map. The boundary voxels of each label and a signed
+distance map of each label (within its padded bounding box) are computed once for both label maps
+in Initialize(). Each call to Update() then maps only the boundary points: fixed boundary points
+through the transform into moving space and moving boundary points through the inverse transform
+into fixed space, and samples the opposite distance map at those points. This is meant for fast
+per-level validation; the full resample (ValidationFilter) is still used for the final report.
+
+Measures per label:
+	a. hausdorff distance (maximum distance from one surface to the other label; points inside the
+	   other label count as 0, as in HausdorffDistanceImageFilter)
+	b. average hausdorff distance (mean of the two directed average surface distances, same clamping)
+	c. surface dice: fraction of boundary points of both labels that lie within the tolerance of
+	   the other label's boundary (absolute signed distance, so points deep inside the other label
+	   do not count as overlapping)
+
+NOTE: Update() is not reentrant; run one Update() at a time per filter. Filters for other threads are
+made with CreateSharedCopy(), which shares the distance maps of an initialized filter.
+
+*/
+
+#ifndef __itkSurfaceValidationFilter_h
+#define __itkSurfaceValidationFilter_h
+
+// include files
+#include "itkImage.h"
+#include "itkTransform.h"
+#include "itkSignedMaurerDistanceMapImageFilter.h"
+
+#include <map>
+#include <vector>
+
+namespace itk
+{
+// class SurfaceValidationFilter
+template< typename TLabelImageType >
+class SurfaceValidationFilter: public Object
+{
+public:
+	// default ITK
+	typedef SurfaceValidationFilter		Self;
+	typedef Object						Superclass;
+	typedef SmartPointer< Self >		Pointer;
+	typedef SmartPointer< const Self >	ConstPointer;
+
+	// definitions
+	typedef TLabelImageType							LabelImageType;
+	typedef typename LabelImageType::PixelType		LabelType;
+	typedef typename LabelImageType::RegionType		RegionType;
+	typedef typename LabelImageType::IndexType		IndexType;
+	typedef typename LabelImageType::PointType		PointType;
+	typedef itk::Image< unsigned char, 3 >			BinaryImageType;
+	typedef itk::Image< float, 3 >					DistanceImageType;
+	typedef itk::SignedMaurerDistanceMapImageFilter< BinaryImageType, DistanceImageType >	DistanceFilterType;
+	typedef itk::Transform< double, 3, 3 >			TransformType;
+
+	// method for creation
+	itkNewMacro(Self);
+
+	// run-time type information and related methods
+	itkTypeMacro(SurfaceValidationFilter, Object);
+
+	// set inputs
+	itkSetConstObjectMacro( FixedLabelMap, LabelImageType );
+	itkSetConstObjectMacro( MovingLabelMap, LabelImageType );
+	itkSetConstObjectMacro( Transform, TransformType );
+
+	// number of voxels added around the bounding boxes of the distance maps
+	itkSetMacro( Padding, unsigned int );
+
+	// distance (mm) within which boundary points count as overlapping (default: largest fixed voxel spacing)
+	itkSetMacro( Tolerance, double );
+
+	// results are printed to this stream (std::cout by default)
+	void SetOutputStream( std::ostream * stream )
+	{
+		m_OutputStream = stream;
+	}
+
+	// extract boundaries and distance maps of both label maps (done once)
+	void Initialize();
+
+	// perform function for the current transform
+	void Update();
+
+	// new initialized filter with the same inputs and settings (distance maps are shared, not recomputed)
+	Pointer CreateSharedCopy() const;
+
+	// get results (-1 if the label is missing from one of the label maps)
+	bool HasLabel( LabelType label ) const
+	{
+		return m_HausdorffDistances.find( label ) != m_HausdorffDistances.end();
+	}
+	double GetHausdorffDistance( LabelType label ) const;
+	double GetAverageHausdorffDistance( LabelType label ) const;
+	double GetSurfaceDice( LabelType label ) const;
+
+protected:
+	// constructor
+	SurfaceValidationFilter();
+
+	// destructor
+	virtual ~SurfaceValidationFilter() {}
+
+private:
+	// inputs
+	typename LabelImageType::ConstPointer m_FixedLabelMap;
+	typename LabelImageType::ConstPointer m_MovingLabelMap;
+	typename TransformType::ConstPointer m_Transform;
+	unsigned int m_Padding;
+	double m_Tolerance;
+	bool m_Initialized;
+
+	// precomputed surface of one label in one label map
+	struct LabelSurfaceType
+	{
+		std::vector< PointType > boundaryPoints;
+		typename DistanceImageType::Pointer distanceMap;
+	};
+	std::map< LabelType, LabelSurfaceType > m_FixedSurfaces;
+	std::map< LabelType, LabelSurfaceType > m_MovingSurfaces;
+	void ComputeSurfaces( const LabelImageType * image, std::map< LabelType, LabelSurfaceType > & surfaces );
+
+	// signed distance (mm) from a point to the boundary of a label, negative inside the label
+	double SampleDistance( const DistanceImageType * distanceMap, const PointType & point ) const;
+
+	// results
+	std::map< LabelType, double > m_HausdorffDistances;
+	std::map< LabelType, double > m_AverageHausdorffDistances;
+	std::map< LabelType, double > m_SurfaceDices;
+
+	// output
+	std::ostream * m_OutputStream;
+};
+} // end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSurfaceValidationFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef __itkSurfaceValidationFilter_hxx
+#define __itkSurfaceValidationFilter_hxx
+
+#include "itkSurfaceValidationFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
+
+namespace itk
+{
+	// constructor
+	template< typename TLabelImageType >
+	SurfaceValidationFilter< TLabelImageType >::SurfaceValidationFilter():
+		m_FixedLabelMap( ITK_NULLPTR ),		// defined by user
+		m_MovingLabelMap( ITK_NULLPTR ),	// defined by user
+		m_Transform( ITK_NULLPTR ),			// defined by user
+		m_Padding( 10 ),
+		m_Tolerance( 0.0 ),
+		m_Initialized( false ),
+		m_OutputStream( &std::cout )
+	{}
+
+	template< typename TLabelImageType >
+	void SurfaceValidationFilter< TLabelImageType >::Initialize()
+	{
+		// error checking
+		if( !m_FixedLabelMap )
+		{
+			itkExceptionMacro( << "Fixed label map not present" );
+		}
+		if( !m_MovingLabelMap )
+		{
+			itkExceptionMacro( << "Moving label map not present" );
+		}
+
+		ComputeSurfaces( this->m_FixedLabelMap, this->m_FixedSurfaces );
+		ComputeSurfaces( this->m_MovingLabelMap, this->m_MovingSurfaces );
+
+		// default tolerance of one voxel
+		if( this->m_Tolerance <= 0.0 )
+		{
+			const typename LabelImageType::SpacingType spacing = this->m_FixedLabelMap->GetSpacing();
+			this->m_Tolerance = std::max( spacing[0], std::max( spacing[1], spacing[2] ) );
+		}
+
+		this->m_Initialized = true;
+		return;
+	}
+
+	template< typename TLabelImageType >
+	void SurfaceValidationFilter< TLabelImageType >::Update()
+	{
+		// error checking
+		if( !m_Transform )
+		{
+			itkExceptionMacro( << "Transform not present" );
+		}
+		if( !this->m_Initialized )
+		{
+			Initialize();
+		}
+
+		// moving boundary points are brought back into fixed space with the inverse
+		typename TransformType::InverseTransformBasePointer inverse = this->m_Transform->GetInverseTransform();
+		if( !inverse )
+		{
+			itkExceptionMacro( << "Transform is not invertible" );
+		}
+
+		this->m_HausdorffDistances.clear();
+		this->m_AverageHausdorffDistances.clear();
+		this->m_SurfaceDices.clear();
+
+		// labels present in either label map
+		std::map< LabelType, bool > labels;
+		typename std::map< LabelType, LabelSurfaceType >::const_iterator sIt;
+		for( sIt = this->m_FixedSurfaces.begin(); sIt != this->m_FixedSurfaces.end(); ++sIt )
+		{
+			labels[sIt->first] = true;
+		}
+		for( sIt = this->m_MovingSurfaces.begin(); sIt != this->m_MovingSurfaces.end(); ++sIt )
+		{
+			labels[sIt->first] = true;
+		}
+
+		typename std::map< LabelType, bool >::const_iterator it;
+		for( it = labels.begin(); it != labels.end(); ++it )
+		{
+			const LabelType label = it->first;
+			typename std::map< LabelType, LabelSurfaceType >::const_iterator fixed = this->m_FixedSurfaces.find( label );
+			typename std::map< LabelType, LabelSurfaceType >::const_iterator moving = this->m_MovingSurfaces.find( label );
+			if( fixed == this->m_FixedSurfaces.end() || moving == this->m_MovingSurfaces.end() )
+			{
+				this->m_HausdorffDistances[label] = -1;
+				this->m_AverageHausdorffDistances[label] = -1;
+				this->m_SurfaceDices[label] = -1;
+				continue;
+			}
+
+			// fixed surface -> moving label
+			double maximum12 = 0.0;
+			double sum12 = 0.0;
+			SizeValueType within12 = 0;
+			const std::vector< PointType > & fixedPoints = fixed->second.boundaryPoints;
+			for( unsigned int i = 0; i < fixedPoints.size(); ++i )
+			{
+				// hausdorff terms: distance to the label; surface dice: distance to its boundary
+				const double signedDistance = SampleDistance( moving->second.distanceMap, this->m_Transform->TransformPoint( fixedPoints[i] ) );
+				const double d = std::max( 0.0, signedDistance );
+				maximum12 = std::max( maximum12, d );
+				sum12 += d;
+				if( std::abs( signedDistance ) <= this->m_Tolerance )
+				{
+					++within12;
+				}
+			}
+
+			// moving surface -> fixed label
+			double maximum21 = 0.0;
+			double sum21 = 0.0;
+			SizeValueType within21 = 0;
+			const std::vector< PointType > & movingPoints = moving->second.boundaryPoints;
+			for( unsigned int i = 0; i < movingPoints.size(); ++i )
+			{
+				// hausdorff terms: distance to the label; surface dice: distance to its boundary
+				const double signedDistance = SampleDistance( fixed->second.distanceMap, inverse->TransformPoint( movingPoints[i] ) );
+				const double d = std::max( 0.0, signedDistance );
+				maximum21 = std::max( maximum21, d );
+				sum21 += d;
+				if( std::abs( signedDistance ) <= this->m_Tolerance )
+				{
+					++within21;
+				}
+			}
+
+			const double count12 = static_cast< double >( fixedPoints.size() );
+			const double count21 = static_cast< double >( movingPoints.size() );
+			this->m_HausdorffDistances[label] = std::max( maximum12, maximum21 );
+			this->m_AverageHausdorffDistances[label] = 0.5*( sum12/count12 + sum21/count21 );
+			this->m_SurfaceDices[label] = ( within12 + within21 )/( count12 + count21 );
+
+			// write out results to screen
+			*this->m_OutputStream << "\nSurface Measures for label: " << static_cast< int >( label ) << std::endl;
+			*this->m_OutputStream << "  Surface Dice (" << this->m_Tolerance << " mm): " << this->m_SurfaceDices[label] << std::endl;
+			*this->m_OutputStream << "  Hausdorff distance    : " << this->m_HausdorffDistances[label] << std::endl;
+			*this->m_OutputStream << "  Average HD            : " << this->m_AverageHausdorffDistances[label] << std::endl;
+			*this->m_OutputStream << std::endl;
+		}
+
+		return;
+	}
+
+	template< typename TLabelImageType >
+	typename SurfaceValidationFilter< TLabelImageType >::Pointer SurfaceValidationFilter< TLabelImageType >::CreateSharedCopy() const
+	{
+		// error checking
+		if( !this->m_Initialized )
+		{
+			itkExceptionMacro( << "Filter not initialized" );
+		}
+
+		// the distance maps are only read by Update(), so the copies point to the same images
+		Pointer copy = Self::New();
+		copy->m_FixedLabelMap = this->m_FixedLabelMap;
+		copy->m_MovingLabelMap = this->m_MovingLabelMap;
+		copy->m_Transform = this->m_Transform;
+		copy->m_Padding = this->m_Padding;
+		copy->m_Tolerance = this->m_Tolerance;
+		copy->m_FixedSurfaces = this->m_FixedSurfaces;
+		copy->m_MovingSurfaces = this->m_MovingSurfaces;
+		copy->m_OutputStream = this->m_OutputStream;
+		copy->m_Initialized = true;
+
+		return copy;
+	}
+
+	template< typename TLabelImageType >
+	double SurfaceValidationFilter< TLabelImageType >::GetHausdorffDistance( LabelType label ) const
+	{
+		typename std::map< LabelType, double >::const_iterator it = m_HausdorffDistances.find( label );
+		return it == m_HausdorffDistances.end() ? -1 : it->second;
+	}
+
+	template< typename TLabelImageType >
+	double SurfaceValidationFilter< TLabelImageType >::GetAverageHausdorffDistance( LabelType label ) const
+	{
+		typename std::map< LabelType, double >::const_iterator it = m_AverageHausdorffDistances.find( label );
+		return it == m_AverageHausdorffDistances.end() ? -1 : it->second;
+	}
+
+	template< typename TLabelImageType >
+	double SurfaceValidationFilter< TLabelImageType >::GetSurfaceDice( LabelType label ) const
+	{
+		typename std::map< LabelType, double >::const_iterator it = m_SurfaceDices.find( label );
+		return it == m_SurfaceDices.end() ? -1 : it->second;
+	}
+
+	// boundary points and distance map of each non-zero label
+	template< typename TLabelImageType >
+	void SurfaceValidationFilter< TLabelImageType >::ComputeSurfaces( const LabelImageType * image, std::map< LabelType, LabelSurfaceType > & surfaces )
+	{
+		surfaces.clear();
+
+		// bounding box of each label in one pass
+		std::map< LabelType, std::pair< IndexType, IndexType > > boxes;
+		ImageRegionConstIteratorWithIndex< LabelImageType > it( image, image->GetBufferedRegion() );
+		for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+		{
+			const LabelType label = it.Get();
+			if( label == 0 )
+			{
+				continue;
+			}
+
+			const IndexType index = it.GetIndex();
+			typename std::map< LabelType, std::pair< IndexType, IndexType > >::iterator box = boxes.find( label );
+			if( box == boxes.end() )
+			{
+				boxes[label] = std::make_pair( index, index );
+				continue;
+			}
+			for( unsigned int d = 0; d < 3; ++d )
+			{
+				box->second.first[d] = std::min( box->second.first[d], index[d] );
+				box->second.second[d] = std::max( box->second.second[d], index[d] );
+			}
+		}
+
+		const RegionType largestRegion = image->GetBufferedRegion();
+		typename std::map< LabelType, std::pair< IndexType, IndexType > >::const_iterator bIt;
+		for( bIt = boxes.begin(); bIt != boxes.end(); ++bIt )
+		{
+			const LabelType label = bIt->first;
+
+			// padded bounding box
+			IndexType start;
+			typename RegionType::SizeType size;
+			for( unsigned int d = 0; d < 3; ++d )
+			{
+				start[d] = bIt->second.first[d] - static_cast< IndexValueType >( m_Padding );
+				size[d] = bIt->second.second[d] - bIt->second.first[d] + 1 + 2*m_Padding;
+			}
+			RegionType region( start, size );
+			region.Crop( largestRegion );
+
+			// binary image of the label limited to the region
+			typename BinaryImageType::Pointer binary = BinaryImageType::New();
+			binary->SetRegions( region );
+			binary->SetOrigin( image->GetOrigin() );
+			binary->SetSpacing( image->GetSpacing() );
+			binary->SetDirection( image->GetDirection() );
+			binary->Allocate();
+
+			ImageRegionConstIterator< LabelImageType > inIt( image, region );
+			ImageRegionIterator< BinaryImageType > outIt( binary, region );
+			for( inIt.GoToBegin(), outIt.GoToBegin(); !inIt.IsAtEnd(); ++inIt, ++outIt )
+			{
+				outIt.Set( inIt.Get() == label ? 1 : 0 );
+			}
+
+			// signed distance (mm), negative inside the label
+			typename DistanceFilterType::Pointer distance = DistanceFilterType::New();
+			distance->SetInput( binary );
+			distance->SetBackgroundValue( 0 );
+			distance->SetUseImageSpacing( true );
+			distance->SetSquaredDistance( false );
+			distance->SetInsideIsPositive( false );
+			distance->Update();
+
+			LabelSurfaceType & surface = surfaces[label];
+			surface.distanceMap = distance->GetOutput();
+
+			// boundary voxels have a face neighbor outside the label (or the region)
+			const long nx = static_cast< long >( region.GetSize()[0] );
+			const long ny = static_cast< long >( region.GetSize()[1] );
+			const long nz = static_cast< long >( region.GetSize()[2] );
+			const long strideY = nx;
+			const long strideZ = nx*ny;
+			const unsigned char * mask = binary->GetBufferPointer();
+			for( long k = 0; k < nz; ++k )
+			{
+				for( long j = 0; j < ny; ++j )
+				{
+					for( long i = 0; i < nx; ++i )
+					{
+						const long idx = k*strideZ + j*strideY + i;
+						if( !mask[idx] )
+						{
+							continue;
+						}
+
+						const bool boundary =
+							i == 0 || !mask[idx - 1] || i == nx - 1 || !mask[idx + 1] ||
+							j == 0 || !mask[idx - strideY] || j == ny - 1 || !mask[idx + strideY] ||
+							k == 0 || !mask[idx - strideZ] || k == nz - 1 || !mask[idx + strideZ];
+						if( !boundary )
+						{
+							continue;
+						}
+
+						IndexType index;
+						index[0] = region.GetIndex()[0] + i;
+						index[1] = region.GetIndex()[1] + j;
+						index[2] = region.GetIndex()[2] + k;
+						PointType point;
+						image->TransformIndexToPhysicalPoint( index, point );
+						surface.boundaryPoints.push_back( point );
+					}
+				}
+			}
+		}
+
+		return;
+	}
+
+	// points outside the distance map are outside the label: they take the value at the closest voxel plus the distance to it
+	template< typename TLabelImageType >
+	double SurfaceValidationFilter< TLabelImageType >::SampleDistance( const DistanceImageType * distanceMap, const PointType & point ) const
+	{
+		IndexType index;
+		if( distanceMap->TransformPhysicalPointToIndex( point, index ) )
+		{
+			return static_cast< double >( distanceMap->GetPixel( index ) );
+		}
+
+		const RegionType region = distanceMap->GetBufferedRegion();
+		for( unsigned int d = 0; d < 3; ++d )
+		{
+			const IndexValueType first = region.GetIndex()[d];
+			const IndexValueType last = first + static_cast< IndexValueType >( region.GetSize()[d] ) - 1;
+			index[d] = std::min( last, std::max( first, index[d] ) );
+		}
+		PointType closest;
+		distanceMap->TransformIndexToPhysicalPoint( index, closest );
+
+		return std::max( 0.0, static_cast< double >( distanceMap->GetPixel( index ) ) ) + point.EuclideanDistanceTo( closest );
+	}
+
+} // end namespace
+
+#endif
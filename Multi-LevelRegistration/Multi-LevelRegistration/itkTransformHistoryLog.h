@@ -0,0 +1,191 @@
+/*
+Purpose: This class keeps the optimizer history of one registration level in a single append-only
+binary file instead of one transform file per step. Every record holds the iteration, the step
+length, the metric value and the transform parameters. Records are flushed as they are appended,
+so the log is usable even if the registration is stopped. extractTransformHistory (SupplementaryCode)
+lists the records or writes .tfm files for chosen iterations.
+
+File layout (native byte order):
+	header: char[8] "TFMHIST1", uint32 number of parameters, uint32 number of fixed parameters,
+	        double fixed parameters[number of fixed parameters]
+	record: int32 iteration, double step length, double metric value, double parameters[number of parameters]
+
+*/
+
+#ifndef __itkTransformHistoryLog_h
+#define __itkTransformHistoryLog_h
+
+// include files
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkArray.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+// class TransformHistoryLog
+class TransformHistoryLog: public Object
+{
+public:
+	// default ITK
+	typedef TransformHistoryLog			Self;
+	typedef Object						Superclass;
+	typedef SmartPointer< Self >		Pointer;
+	typedef SmartPointer< const Self >	ConstPointer;
+
+	// definitions
+	typedef Array< double >				ParametersType;
+	struct RecordType
+	{
+		int iteration;
+		double stepLength;
+		double value;
+		std::vector< double > parameters;
+	};
+
+	// method for creation
+	itkNewMacro(Self);
+
+	// run-time type information and related methods
+	itkTypeMacro(TransformHistoryLog, Object);
+
+	// create the file (an existing log is replaced) and write the header
+	void Open( const std::string & filename, unsigned int numberOfParameters, const ParametersType & fixedParameters )
+	{
+		this->Close();
+		m_File = std::fopen( filename.c_str(), "wb" );
+		if( !m_File )
+		{
+			itkExceptionMacro( << "Could not open transform history " << filename );
+		}
+
+		const unsigned int numberOfFixedParameters = fixedParameters.Size();
+		std::fwrite( Magic(), 1, 8, m_File );
+		std::fwrite( &numberOfParameters, sizeof( unsigned int ), 1, m_File );
+		std::fwrite( &numberOfFixedParameters, sizeof( unsigned int ), 1, m_File );
+		for( unsigned int i = 0; i < numberOfFixedParameters; ++i )
+		{
+			const double fixed = fixedParameters[i];
+			std::fwrite( &fixed, sizeof( double ), 1, m_File );
+		}
+		std::fflush( m_File );
+		m_NumberOfParameters = numberOfParameters;
+	}
+
+	bool IsOpen() const
+	{
+		return m_File != ITK_NULLPTR;
+	}
+
+	// add one optimizer iteration
+	void Append( int iteration, double stepLength, double value, const ParametersType & parameters )
+	{
+		if( !m_File )
+		{
+			itkExceptionMacro( << "Transform history is not open" );
+		}
+		if( parameters.Size() != m_NumberOfParameters )
+		{
+			itkExceptionMacro( << "Expected " << m_NumberOfParameters << " parameters, got " << parameters.Size() );
+		}
+
+		// one write per record
+		m_Buffer.resize( m_NumberOfParameters + 2 );
+		m_Buffer[0] = stepLength;
+		m_Buffer[1] = value;
+		for( unsigned int i = 0; i < m_NumberOfParameters; ++i )
+		{
+			m_Buffer[i + 2] = parameters[i];
+		}
+		std::fwrite( &iteration, sizeof( int ), 1, m_File );
+		std::fwrite( &m_Buffer[0], sizeof( double ), m_Buffer.size(), m_File );
+		std::fflush( m_File );
+	}
+
+	void Close()
+	{
+		if( m_File )
+		{
+			std::fclose( m_File );
+			m_File = ITK_NULLPTR;
+		}
+	}
+
+	// read a whole log
+	static void Read( const std::string & filename, ParametersType & fixedParameters, std::vector< RecordType > & records )
+	{
+		records.clear();
+		std::FILE * file = std::fopen( filename.c_str(), "rb" );
+		if( !file )
+		{
+			itkGenericExceptionMacro( << "Could not open transform history " << filename );
+		}
+
+		char magic[8];
+		unsigned int numberOfParameters = 0;
+		unsigned int numberOfFixedParameters = 0;
+		if( std::fread( magic, 1, 8, file ) != 8 || std::memcmp( magic, Magic(), 8 ) != 0 ||
+			std::fread( &numberOfParameters, sizeof( unsigned int ), 1, file ) != 1 ||
+			std::fread( &numberOfFixedParameters, sizeof( unsigned int ), 1, file ) != 1 )
+		{
+			std::fclose( file );
+			itkGenericExceptionMacro( << filename << " is not a transform history" );
+		}
+
+		std::vector< double > fixed( numberOfFixedParameters );
+		if( numberOfFixedParameters > 0 &&
+			std::fread( &fixed[0], sizeof( double ), numberOfFixedParameters, file ) != numberOfFixedParameters )
+		{
+			std::fclose( file );
+			itkGenericExceptionMacro( << "Truncated header in " << filename );
+		}
+		fixedParameters.SetSize( numberOfFixedParameters );
+		for( unsigned int i = 0; i < numberOfFixedParameters; ++i )
+		{
+			fixedParameters[i] = fixed[i];
+		}
+
+		// a partially written last record (interrupted run) is ignored
+		std::vector< double > buffer( numberOfParameters + 2 );
+		RecordType record;
+		while( std::fread( &record.iteration, sizeof( int ), 1, file ) == 1 &&
+			std::fread( &buffer[0], sizeof( double ), buffer.size(), file ) == buffer.size() )
+		{
+			record.stepLength = buffer[0];
+			record.value = buffer[1];
+			record.parameters.assign( buffer.begin() + 2, buffer.end() );
+			records.push_back( record );
+		}
+		std::fclose( file );
+	}
+
+protected:
+	// constructor
+	TransformHistoryLog():
+		m_File( ITK_NULLPTR ),
+		m_NumberOfParameters( 0 )
+	{}
+
+	// destructor
+	virtual ~TransformHistoryLog()
+	{
+		this->Close();
+	}
+
+private:
+	static const char * Magic()
+	{
+		return "TFMHIST1";
+	}
+
+	std::FILE * m_File;
+	unsigned int m_NumberOfParameters;
+	std::vector< double > m_Buffer;
+};
+} // end namespace
+
+#endif
@@ -10,9 +10,13 @@ Purpose: This class performs registration validation with three different types:
 	c. dice overlap
 	d. hausdorff distance
 	e. average hausdorff distance
-3. Checkerboard image creation given two registered images
+3. Comparison image creation (checkerboard, absolute difference or overlay) given the fixed image
+   and the moving image with its transform. The moving image is resampled on the fly and the result
+   is streamed to disk in slabs, so neither the resampled image nor the comparison image is held
+   in memory as a whole (streaming requires a format that supports it, e.g. uncompressed .mha).
 
 NOTE: This filter requires that the final transform for alignment has already been applied
+(except for the comparison image when a transform is given)
 
 Remaining to implement:
 1. fiducial comparison
@@ -24,17 +28,41 @@ Remaining to implement:
 #define __itkValidationFilter_h
 
 // include files
-#include "itkLabelOverlapMeasuresImageFilter.h"
-#include "itkMinimumMaximumImageCalculator.h"
-#include "itkHausdorffDistanceImageFilter.h"
-#include "itkBinaryThresholdImageFilter.h"
-#include "itkLabelStatisticsImageFilter.h"
-#include "itkCastImageFilter.h"
+#include "itkBoundingBoxHausdorffDistanceFilter.h"
 
 #include "itkCheckerBoardImageFilter.h"
+#include "itkAbsoluteValueDifferenceImageFilter.h"
+#include "itkBinaryFunctorImageFilter.h"
+#include "itkResampleImageFilter.h"
+#include "itkImageFileWriter.h"
+#include "itkMultiThreader.h"
+
+#include <vector>
 
 namespace itk
 {
+namespace Functor
+{
+// equal blend of two images for the overlay comparison image
+template< typename TPixelType >
+class OverlayBlend
+{
+public:
+	bool operator!=( const OverlayBlend & ) const
+	{
+		return false;
+	}
+	bool operator==( const OverlayBlend & other ) const
+	{
+		return !( *this != other );
+	}
+	inline TPixelType operator()( const TPixelType & a, const TPixelType & b ) const
+	{
+		return static_cast< TPixelType >( 0.5*( static_cast< double >( a ) + static_cast< double >( b ) ) );
+	}
+};
+} // end namespace Functor
+
 // class Validation
 template< typename TPixelType >
 class ValidationFilter: public Object
@@ -49,6 +77,15 @@ public:
 	// definitions
 	typedef itk::Image< TPixelType, 3 >	ImageType;
 	typedef itk::Image< unsigned char, 3>	MaskImageType;
+	typedef itk::Transform< double, 3, 3 >	TransformType;
+
+	// comparison image types
+	enum ComparisonModeType
+	{
+		Checkerboard,
+		AbsoluteDifference,
+		Overlay
+	};
 	
 	// method for creation
 	itkNewMacro(Self);
@@ -91,15 +128,27 @@ public:
 		m_LabelMapOverlapMeasures = false;
 	}
 
-	// checkerboard images
-	itkGetObjectMacro( CBImage, ImageType );
-	void CheckerboardImageOn()
+	// results are printed to this stream (std::cout by default)
+	void SetOutputStream( std::ostream * stream )
+	{
+		m_OutputStream = stream;
+	}
+
+	// comparison images (Image1 = fixed image, Image2 = moving image resampled through the transform if given)
+	itkSetConstObjectMacro( Transform, TransformType );
+	itkSetMacro( ComparisonMode, ComparisonModeType );
+	itkSetMacro( NumberOfStreamDivisions, unsigned int );
+	void SetComparisonImageFilename( std::string filename )
 	{
-		m_CheckerboardImage = true;
+		m_ComparisonImageFilename = filename;
 	}
-	void CheckerboardImageOff()
+	void ComparisonImageOn()
 	{
-		m_CheckerboardImage = false;
+		m_ComparisonImage = true;
+	}
+	void ComparisonImageOff()
+	{
+		m_ComparisonImage = false;
 	}
 
 protected:
@@ -128,14 +177,50 @@ private:
 	// overlap measures
 	bool m_LabelMapOverlapMeasures;
 	void LabelOverlapMeasures();
-	void LabelOverlapMeasuresByLabel(MaskImageType::Pointer sourceLabel, MaskImageType::Pointer targetLabel, int label);
-	MaskImageType::Pointer IsolateLabel(MaskImageType::Pointer labelMap, int label);
-	int GetStatistics(typename ImageType::Pointer image, MaskImageType::Pointer label);
+	void LabelOverlapMeasuresByLabel(int label, double hausdorffDistance, double averageHausdorffDistance);
+
+	// intensity statistics of one label
+	struct LabelStatisticsType
+	{
+		SizeValueType count;
+		double sum;
+		double sumOfSquares;
+		double minimum;
+		double maximum;
+	};
+
+	// values accumulated by one thread (merged once all threads are done)
+	struct ThreadAccumulatorType
+	{
+		std::vector< SizeValueType > confusionMatrix;
+		std::vector< LabelStatisticsType > statistics1;
+		std::vector< LabelStatisticsType > statistics2;
+	};
+
+	// label statistics of both images and the label confusion matrix are computed in one threaded scan
+	// m_ConfusionMatrix[source*256 + target] = number of voxels
+	static const unsigned int NumberOfLabelValues = 256;
+	std::vector< SizeValueType > m_ConfusionMatrix;
+	std::vector< LabelStatisticsType > m_Statistics1;
+	std::vector< LabelStatisticsType > m_Statistics2;
+	std::vector< ThreadAccumulatorType > m_ThreadAccumulators;
+	void ComputeLabelStatistics();
+	static ITK_THREAD_RETURN_TYPE LabelStatisticsThreaderCallback( void * arg );
+	void ThreadedLabelStatistics( unsigned int threadId, unsigned int numberOfThreads );
+	static void InitializeStatistics( std::vector< LabelStatisticsType > & statistics );
+	static void MergeStatistics( std::vector< LabelStatisticsType > & statistics, const std::vector< LabelStatisticsType > & other );
+	int PrintStatistics( const std::vector< LabelStatisticsType > & statistics );
 	
-	// checkerboard images
-	bool m_CheckerboardImage;
-	typename ImageType::Pointer m_CBImage;
-	void CheckerboardImage();	
+	// comparison images
+	bool m_ComparisonImage;
+	TransformType::ConstPointer m_Transform;
+	ComparisonModeType m_ComparisonMode;
+	unsigned int m_NumberOfStreamDivisions;
+	std::string m_ComparisonImageFilename;
+	void ComparisonImage();
+
+	// output
+	std::ostream * m_OutputStream;
 };
 } // end namespace
 
@@ -16,7 +16,11 @@ namespace itk
 		m_MovingFiducialFilename( ITK_NULLPTR ),	// defined by user
 		m_FiducialAlignment( false ),
 		m_LabelMapOverlapMeasures( false ),
-		m_CheckerboardImage( false )
+		m_ComparisonImage( false ),
+		m_Transform( ITK_NULLPTR ),
+		m_ComparisonMode( Checkerboard ),
+		m_NumberOfStreamDivisions( 20 ),
+		m_OutputStream( &std::cout )
 		{}
 
 	// perform desired measures
@@ -28,21 +32,21 @@ namespace itk
 		{
 			if( !m_LabelMap1 )
 			{
-				std::cout << "Label map 1 not present" << std::endl;
+				itkExceptionMacro( << "Label map 1 not present" );
 			}
 			if( !m_LabelMap2 )
 			{
-				std::cout << "Label map 2 not present" << std::endl;
+				itkExceptionMacro( << "Label map 2 not present" );
 			}
 			if( !m_Image1 )
 			{
-				std::cout << "Image 1 not present" << std::endl;
+				itkExceptionMacro( << "Image 1 not present" );
 			}
 			if( !m_Image2 )
 			{
-				std::cout << "Image 2 not present" << std::endl;
+				itkExceptionMacro( << "Image 2 not present" );
 			}
-			std::cout << "Computing overlap measures." << std::endl;
+			*this->m_OutputStream << "Computing overlap measures." << std::endl;
 			LabelOverlapMeasures();
 		}
 
@@ -51,29 +55,33 @@ namespace itk
 		{
 			if( !m_FixedFiducialFilename )
 			{
-				std::cout << "Fixed fiducials not present" << std::endl;
+				*this->m_OutputStream << "Fixed fiducials not present" << std::endl;
 			}
 			if( !m_MovingFiducialFilename )
 			{
-				std::cout << "Moving fiducials not present" << std::endl;
+				*this->m_OutputStream << "Moving fiducials not present" << std::endl;
 			}
-			std::cout << "Computing fiducial alignment." << std::endl;
+			*this->m_OutputStream << "Computing fiducial alignment." << std::endl;
 			FiducialAlignment();
 		}
 
-		// compute checkerboard image
-		if( this->m_CheckerboardImage )
+		// compute comparison image
+		if( this->m_ComparisonImage )
 		{
 			if( !m_Image1 )
 			{
-				std::cout << "Image 1 not present" << std::endl;
+				*this->m_OutputStream << "Image 1 not present" << std::endl;
 			}
 			if( !m_Image2 )
 			{
-				std::cout << "Image 2 not present" << std::endl;
+				*this->m_OutputStream << "Image 2 not present" << std::endl;
 			}
-			std::cout << "Computing checkerboard image." << std::endl;
-			CheckerboardImage();
+			if( m_ComparisonImageFilename.empty() )
+			{
+				*this->m_OutputStream << "Comparison image filename not present" << std::endl;
+			}
+			*this->m_OutputStream << "Computing comparison image." << std::endl;
+			ComparisonImage();
 		}
 
 		return;
@@ -83,202 +91,355 @@ namespace itk
 	template< typename TPixelType >
 	void ValidationFilter< TPixelType >::LabelOverlapMeasures()
 	{
-		// create temp images
-		MaskImageType::Pointer source = MaskImageType::New();
-		MaskImageType::Pointer target = MaskImageType::New();
-
-		// find range of values in images
-		typedef itk::MinimumMaximumImageCalculator< MaskImageType >		MinMaxCalculatorType;
-		MinMaxCalculatorType::Pointer calculator = MinMaxCalculatorType::New();
-		calculator->SetImage( this->m_LabelMap1 );
-		calculator->Compute();
-		int sMax = calculator->GetMaximum();
-
-		// repeat for target image
-		calculator->SetImage( this->m_LabelMap2 );
-		calculator->Compute();
-		int tMax = calculator->GetMaximum();
+		// statistics of both images and the confusion matrix in one pass
+		ComputeLabelStatistics();
+
+		// find range of values in label maps
+		int sMax = 0;
+		int tMax = 0;
+		for( unsigned int i = 0; i < NumberOfLabelValues; ++i )
+		{
+			if( this->m_Statistics1[i].count > 0 )
+			{
+				sMax = i;
+			}
+			if( this->m_Statistics2[i].count > 0 )
+			{
+				tMax = i;
+			}
+		}
 
 		// get number of labels in labelMaps
-		std::cout << "\nImage #1: " << std::endl;
-		int numberOfSourceLabels = GetStatistics( this->m_Image1, this->m_LabelMap1 );
-		std::cout << "\nImage #2: " << std::endl;
-		int numberOfTargetLabels = GetStatistics( this->m_Image2, this->m_LabelMap2 );
+		*this->m_OutputStream << "\nImage #1: " << std::endl;
+		int numberOfSourceLabels = PrintStatistics( this->m_Statistics1 );
+		*this->m_OutputStream << "\nImage #2: " << std::endl;
+		int numberOfTargetLabels = PrintStatistics( this->m_Statistics2 );
 
 		// check if the label maps agree
 		if( numberOfSourceLabels != numberOfTargetLabels || sMax != tMax )
 		{
-			std::cout << "Err: LabelMap images do not agree" << std::endl;
+			*this->m_OutputStream << "Err: LabelMap images do not agree" << std::endl;
 			return;
 		}
-		
-		// find overlap measures if there is more than one label
-		if( numberOfSourceLabels-1 > 1 )
+
+		// Hausdorff distances for all labels (same values as HausdorffDistanceImageFilter, computed within each label's bounding box)
+		typedef itk::BoundingBoxHausdorffDistanceFilter< MaskImageType >	DistanceFilterType;
+		typename DistanceFilterType::Pointer distanceFilter = DistanceFilterType::New();
+		distanceFilter->SetInput1( this->m_LabelMap1 );
+		distanceFilter->SetInput2( this->m_LabelMap2 );
+		try
 		{
-			for( int i = 1; i < sMax; ++i )
-			{
-				source = IsolateLabel( this->m_LabelMap1, i );
-				target = IsolateLabel( this->m_LabelMap2, i );
-				LabelOverlapMeasuresByLabel( source, target, i );
-			}
+			distanceFilter->Update();
 		}
-		// or if there is not
-		else
+		catch(itk::ExceptionObject & err)
+		{
+			std::cerr << "Exception Object Caught!" << std::endl;
+			std::cerr << err << std::endl;
+			std::cerr << std::endl;
+		}
+
+		// find overlap measures for each label present
+		for( int i = 1; i <= sMax; ++i )
 		{
-			LabelOverlapMeasuresByLabel( this->m_LabelMap1, this->m_LabelMap2, sMax );
+			if( distanceFilter->HasLabel( i ) )
+			{
+				LabelOverlapMeasuresByLabel( i, distanceFilter->GetHausdorffDistance( i ), distanceFilter->GetAverageHausdorffDistance( i ) );
+			}
 		}
 
 		return;
 	}
 
-	// calculate overlap measures according to the label in the image
+	// compute label statistics of both images and the label confusion matrix with one threaded scan
 	template< typename TPixelType >
-	void ValidationFilter< TPixelType >::LabelOverlapMeasuresByLabel( MaskImageType::Pointer sourceLabel, MaskImageType::Pointer targetLabel, int label)
+	void ValidationFilter< TPixelType >::ComputeLabelStatistics()
 	{
-		// declare and input images
-		typedef itk::LabelOverlapMeasuresImageFilter< MaskImageType >	OverlapFilterType;
-		OverlapFilterType::Pointer overlapFilter = OverlapFilterType::New();
-		overlapFilter->SetSourceImage(sourceLabel);
-		overlapFilter->SetTargetImage(targetLabel);
-
-		// update filter
-		try
-		{
-			overlapFilter->Update();
-		}
-		catch(itk::ExceptionObject & err)
+		const typename ImageType::RegionType region = this->m_LabelMap1->GetBufferedRegion();
+		if( this->m_LabelMap2->GetBufferedRegion() != region ||
+			this->m_Image1->GetBufferedRegion() != region ||
+			this->m_Image2->GetBufferedRegion() != region )
 		{
-			std::cerr << "Exception Object Caught!" << std::endl;
-			std::cerr << err << std::endl;
-			std::cerr << std::endl;
+			itkExceptionMacro( << "Images and label maps must occupy the same region" );
 		}
 
-		// calculate Hausdorff distances
-		typedef itk::HausdorffDistanceImageFilter< MaskImageType, MaskImageType >	DistanceFilterType;
-		DistanceFilterType::Pointer distanceFilter = DistanceFilterType::New();
-		distanceFilter->SetInput1(sourceLabel);
-		distanceFilter->SetInput2(targetLabel);
-		
-		// update filter
-		try
+		// each thread accumulates into its own tables
+		MultiThreader::Pointer threader = MultiThreader::New();
+		this->m_ThreadAccumulators.assign( threader->GetNumberOfThreads(), ThreadAccumulatorType() );
+		threader->SetSingleMethod( this->LabelStatisticsThreaderCallback, this );
+		threader->SingleMethodExecute();
+
+		// merge once all threads have finished (no locking needed)
+		this->m_ConfusionMatrix.assign( NumberOfLabelValues*NumberOfLabelValues, 0 );
+		InitializeStatistics( this->m_Statistics1 );
+		InitializeStatistics( this->m_Statistics2 );
+		for( unsigned int t = 0; t < this->m_ThreadAccumulators.size(); ++t )
 		{
-			distanceFilter->Update();
+			const ThreadAccumulatorType & accumulator = this->m_ThreadAccumulators[t];
+			for( unsigned int i = 0; i < accumulator.confusionMatrix.size(); ++i )
+			{
+				this->m_ConfusionMatrix[i] += accumulator.confusionMatrix[i];
+			}
+			MergeStatistics( this->m_Statistics1, accumulator.statistics1 );
+			MergeStatistics( this->m_Statistics2, accumulator.statistics2 );
 		}
-		catch(itk::ExceptionObject & err)
+		this->m_ThreadAccumulators.clear();
+
+		*this->m_OutputStream << "Statistics calculated." << std::endl;
+		return;
+	}
+
+	template< typename TPixelType >
+	ITK_THREAD_RETURN_TYPE ValidationFilter< TPixelType >::LabelStatisticsThreaderCallback( void * arg )
+	{
+		MultiThreader::ThreadInfoStruct * info = static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+		Self * self = static_cast< Self * >( info->UserData );
+		self->ThreadedLabelStatistics( info->ThreadID, info->NumberOfThreads );
+		return ITK_THREAD_RETURN_VALUE;
+	}
+
+	template< typename TPixelType >
+	void ValidationFilter< TPixelType >::ThreadedLabelStatistics( unsigned int threadId, unsigned int numberOfThreads )
+	{
+		// split the buffers into contiguous chunks
+		const SizeValueType numberOfPixels = this->m_LabelMap1->GetBufferedRegion().GetNumberOfPixels();
+		const SizeValueType chunk = ( numberOfPixels + numberOfThreads - 1 ) / numberOfThreads;
+		const SizeValueType first = std::min( numberOfPixels, threadId*chunk );
+		const SizeValueType last = std::min( numberOfPixels, first + chunk );
+
+		ThreadAccumulatorType & accumulator = this->m_ThreadAccumulators[threadId];
+		accumulator.confusionMatrix.assign( NumberOfLabelValues*NumberOfLabelValues, 0 );
+		InitializeStatistics( accumulator.statistics1 );
+		InitializeStatistics( accumulator.statistics2 );
+
+		const unsigned char * source = this->m_LabelMap1->GetBufferPointer();
+		const unsigned char * target = this->m_LabelMap2->GetBufferPointer();
+		const TPixelType * image1 = this->m_Image1->GetBufferPointer();
+		const TPixelType * image2 = this->m_Image2->GetBufferPointer();
+		for( SizeValueType i = first; i < last; ++i )
 		{
-			std::cerr << "Exception Object Caught!" << std::endl;
-			std::cerr << err << std::endl;
-			std::cerr << std::endl;
+			// label to label
+			++accumulator.confusionMatrix[ source[i]*NumberOfLabelValues + target[i] ];
+
+			// image to label
+			const double value1 = static_cast< double >( image1[i] );
+			LabelStatisticsType & statistics1 = accumulator.statistics1[ source[i] ];
+			++statistics1.count;
+			statistics1.sum += value1;
+			statistics1.sumOfSquares += value1*value1;
+			statistics1.minimum = std::min( statistics1.minimum, value1 );
+			statistics1.maximum = std::max( statistics1.maximum, value1 );
+
+			const double value2 = static_cast< double >( image2[i] );
+			LabelStatisticsType & statistics2 = accumulator.statistics2[ target[i] ];
+			++statistics2.count;
+			statistics2.sum += value2;
+			statistics2.sumOfSquares += value2*value2;
+			statistics2.minimum = std::min( statistics2.minimum, value2 );
+			statistics2.maximum = std::max( statistics2.maximum, value2 );
 		}
 
-		// write out results to screen
-		std::cout << "\nOverlap Measures for label: " << label << std::endl;
-		std::cout << "  Total overlap         : " << overlapFilter->GetTotalOverlap() << std::endl;
-		std::cout << "  Union(Jaccard) overlap: " << overlapFilter->GetUnionOverlap() << std::endl;
-		std::cout << "  Mean(Dice) overlap    : " << overlapFilter->GetMeanOverlap() << std::endl;
-		std::cout << "  Hausdorff distance    : " << distanceFilter->GetHausdorffDistance() << std::endl;
-		std::cout << "  Average HD            : " << distanceFilter->GetAverageHausdorffDistance() << std::endl;
-		std::cout << std::endl;
+		return;
+	}
+
+	template< typename TPixelType >
+	void ValidationFilter< TPixelType >::InitializeStatistics( std::vector< LabelStatisticsType > & statistics )
+	{
+		LabelStatisticsType empty;
+		empty.count = 0;
+		empty.sum = 0.0;
+		empty.sumOfSquares = 0.0;
+		empty.minimum = NumericTraits< double >::max();
+		empty.maximum = NumericTraits< double >::NonpositiveMin();
+		statistics.assign( NumberOfLabelValues, empty );
 
 		return;
 	}
 
 	template< typename TPixelType >
-	typename ValidationFilter< TPixelType >::MaskImageType::Pointer ValidationFilter< TPixelType >::IsolateLabel(MaskImageType::Pointer labelMap, int label)
+	void ValidationFilter< TPixelType >::MergeStatistics( std::vector< LabelStatisticsType > & statistics, const std::vector< LabelStatisticsType > & other )
 	{
-		// set up thresholding
-		typedef itk::BinaryThresholdImageFilter< MaskImageType, MaskImageType >	ThresholdType;
-		ThresholdType::Pointer threshold = ThresholdType::New();
-		threshold->SetInput( labelMap );
-		threshold->SetLowerThreshold( label );
-		threshold->SetUpperThreshold( label );
-		threshold->SetInsideValue( 1 );
-		threshold->SetOutsideValue( 0 );
-
-		// update filter
-		try
+		for( unsigned int i = 0; i < other.size(); ++i )
 		{
-			threshold->Update();
+			statistics[i].count += other[i].count;
+			statistics[i].sum += other[i].sum;
+			statistics[i].sumOfSquares += other[i].sumOfSquares;
+			statistics[i].minimum = std::min( statistics[i].minimum, other[i].minimum );
+			statistics[i].maximum = std::max( statistics[i].maximum, other[i].maximum );
 		}
-		catch(itk::ExceptionObject & err)
+
+		return;
+	}
+
+	// calculate overlap measures according to the label in the image
+	template< typename TPixelType >
+	void ValidationFilter< TPixelType >::LabelOverlapMeasuresByLabel( int label, double hausdorffDistance, double averageHausdorffDistance )
+	{
+		// derive overlap from the confusion matrix
+		double sourceCount = 0.0;
+		double targetCount = 0.0;
+		for( unsigned int i = 0; i < NumberOfLabelValues; ++i )
 		{
-			std::cerr << "Exception Object Caught!" << std::endl;
-			std::cerr << err << std::endl;
-			std::cerr << std::endl;
+			sourceCount += this->m_ConfusionMatrix[label*NumberOfLabelValues + i];
+			targetCount += this->m_ConfusionMatrix[i*NumberOfLabelValues + label];
 		}
+		const double intersection = this->m_ConfusionMatrix[label*NumberOfLabelValues + label];
+		const double totalOverlap = targetCount > 0 ? intersection/targetCount : 0.0;
+		const double unionOverlap = ( sourceCount + targetCount - intersection ) > 0 ? intersection/( sourceCount + targetCount - intersection ) : 0.0;
+		const double meanOverlap = ( sourceCount + targetCount ) > 0 ? 2.0*intersection/( sourceCount + targetCount ) : 0.0;
 
-		std::cout << "Label " << label << " isolated." << std::endl;
+		// write out results to screen
+		*this->m_OutputStream << "\nOverlap Measures for label: " << label << std::endl;
+		*this->m_OutputStream << "  Total overlap         : " << totalOverlap << std::endl;
+		*this->m_OutputStream << "  Union(Jaccard) overlap: " << unionOverlap << std::endl;
+		*this->m_OutputStream << "  Mean(Dice) overlap    : " << meanOverlap << std::endl;
+		*this->m_OutputStream << "  Hausdorff distance    : " << hausdorffDistance << std::endl;
+		*this->m_OutputStream << "  Average HD            : " << averageHausdorffDistance << std::endl;
+		*this->m_OutputStream << std::endl;
 
-		// get isolated label
-		return threshold->GetOutput();
+		return;
 	}
 
+	// print statistics of each label and return the number of labels (including background)
 	template< typename TPixelType >
-	int ValidationFilter< TPixelType >::GetStatistics(typename ImageType::Pointer image, MaskImageType::Pointer label)
+	int ValidationFilter< TPixelType >::PrintStatistics( const std::vector< LabelStatisticsType > & statistics )
 	{
-		// convert label map to image type
-		typedef itk::CastImageFilter< MaskImageType, MaskImageType >	ConvertLabelMapFilterType;
-		ConvertLabelMapFilterType::Pointer convert = ConvertLabelMapFilterType::New();
-		convert->SetInput( label );
-		convert->Update();
+		int numberOfLabels = 0;
+		for( unsigned int i = 0; i < statistics.size(); ++i )
+		{
+			if( statistics[i].count > 0 )
+			{
+				++numberOfLabels;
+			}
+		}
+		*this->m_OutputStream << "Number of labels: " << numberOfLabels << std::endl;
 
-		// set up statistics filter
-		typedef itk::LabelStatisticsImageFilter< ImageType, MaskImageType > StatisticsFilterType;
-		StatisticsFilterType::Pointer statistics = StatisticsFilterType::New();
-		statistics->SetLabelInput( convert->GetOutput() );
-		statistics->SetInput( image );
-		statistics->Update();
+		for( unsigned int value = 1; value < statistics.size(); ++value )
+		{
+			const LabelStatisticsType & label = statistics[value];
+			if( label.count == 0 )
+			{
+				continue;
+			}
+
+			// unbiased variance (as in LabelStatisticsImageFilter)
+			const double count = static_cast< double >( label.count );
+			const double mean = label.sum/count;
+			double variance = 0.0;
+			if( label.count > 1 )
+			{
+				variance = std::max( 0.0, ( label.sumOfSquares - label.sum*label.sum/count )/( count - 1.0 ) );
+			}
 
-		std::cout << "Statistics calculated." << std::endl;
+			*this->m_OutputStream << "Label value: " << value << std::endl;
+			*this->m_OutputStream << "  Mean   : " << mean << std::endl;
+			*this->m_OutputStream << "  St. Dev: " << std::sqrt( variance ) << std::endl;
+			*this->m_OutputStream << "  Minimum: " << label.minimum << std::endl;
+			*this->m_OutputStream << "  Maximum: " << label.maximum << std::endl;
+			*this->m_OutputStream << "  Count  : " << label.count << std::endl;
+		}
 
-		// print out basic statistics to output
-		typedef StatisticsFilterType::ValidLabelValuesContainerType ValidLabelValuesType;
-	    typedef StatisticsFilterType::LabelPixelType                LabelPixelType;
+		return numberOfLabels;
+	}
 
-		std::cout << "Number of labels: " << statistics->GetNumberOfLabels() << std::endl;
+	// stream the comparison image to disk slab by slab
+	template< typename TPixelType >
+	void ValidationFilter< TPixelType >::ComparisonImage()
+	{
+		// moving image in the space of the fixed image (only the requested slab is resampled)
+		typedef itk::ResampleImageFilter< ImageType, ImageType >	ResampleFilterType;
+		typename ResampleFilterType::Pointer resample = ResampleFilterType::New();
+		ImageSource< ImageType > * moving = ITK_NULLPTR;
+		if( this->m_Transform )
+		{
+			resample->SetInput( this->m_Image2 );
+			resample->SetTransform( this->m_Transform );
+			resample->SetReferenceImage( this->m_Image1 );
+			resample->UseReferenceImageOn();
+			resample->SetDefaultPixelValue( 0 );
+			moving = resample;
+		}
 
-		for( ValidLabelValuesType::const_iterator vIt = statistics->GetValidLabelValues().begin(); vIt != statistics->GetValidLabelValues().end(); ++vIt )
+		// combine the images according to the mode
+		typename ImageSource< ImageType >::Pointer comparison;
+		if( this->m_ComparisonMode == AbsoluteDifference )
 		{
-			if( statistics->HasLabel( *vIt ) )
+			typedef itk::AbsoluteValueDifferenceImageFilter< ImageType, ImageType, ImageType >	DifferenceFilterType;
+			typename DifferenceFilterType::Pointer difference = DifferenceFilterType::New();
+			difference->SetInput1( this->m_Image1 );
+			if( moving )
 			{
-				LabelPixelType value = *vIt;
-				if( value > 0 )
-				{
-					std::cout << "Label value: " << value << std::endl;
-					std::cout << "  Mean   : " << statistics->GetMean( value ) << std::endl;
-					std::cout << "  St. Dev: " << statistics->GetSigma( value ) << std::endl;
-					std::cout << "  Count  : " << statistics->GetCount( value ) << std::endl;
-				}
+				difference->SetInput2( moving->GetOutput() );
 			}
+			else
+			{
+				difference->SetInput2( this->m_Image2 );
+			}
+			comparison = difference;
+		}
+		else if( this->m_ComparisonMode == Overlay )
+		{
+			typedef itk::BinaryFunctorImageFilter< ImageType, ImageType, ImageType, Functor::OverlayBlend< TPixelType > >	OverlayFilterType;
+			typename OverlayFilterType::Pointer overlay = OverlayFilterType::New();
+			overlay->SetInput1( this->m_Image1 );
+			if( moving )
+			{
+				overlay->SetInput2( moving->GetOutput() );
+			}
+			else
+			{
+				overlay->SetInput2( this->m_Image2 );
+			}
+			comparison = overlay;
+		}
+		else
+		{
+			typedef itk::CheckerBoardImageFilter< ImageType >	CheckerboardFilterType;
+			typename CheckerboardFilterType::Pointer checker = CheckerboardFilterType::New();
+			checker->SetInput1( this->m_Image1 );
+			if( moving )
+			{
+				checker->SetInput2( moving->GetOutput() );
+			}
+			else
+			{
+				checker->SetInput2( this->m_Image2 );
+			}
+
+			// define pattern type
+			typename CheckerboardFilterType::PatternArrayType pattern;
+			pattern[0] = 4;
+			pattern[1] = 4;
+			pattern[2] = 4;
+			checker->SetCheckerPattern( pattern );
+			comparison = checker;
 		}
 
-		return statistics->GetNumberOfLabels();
-	}
+		// write out in slabs along the slowest dimension
+		typedef itk::ImageFileWriter< ImageType >	WriterType;
+		typename WriterType::Pointer writer = WriterType::New();
+		writer->SetInput( comparison->GetOutput() );
+		writer->SetFileName( this->m_ComparisonImageFilename );
+		writer->SetNumberOfStreamDivisions( this->m_NumberOfStreamDivisions );
+		writer->UseCompressionOff();
+		try
+		{
+			writer->Update();
+			*this->m_OutputStream << "Comparison image written: " << this->m_ComparisonImageFilename << std::endl;
+		}
+		catch(itk::ExceptionObject & err)
+		{
+			std::cerr << "Exception Object Caught!" << std::endl;
+			std::cerr << err << std::endl;
+			std::cerr << std::endl;
+		}
 
-	template< typename TPixelType >
-	void ValidationFilter< TPixelType >::CheckerboardImage()
-	{
-		//declare and insert inputs
-		typedef itk::CheckerBoardImageFilter< ImageType >	CheckerboardFilterType;
-		CheckerboardFilterType::Pointer checker = CheckerboardFilterType::New();
-		checker->SetInput1( this->m_Image1 );
-		checker->SetInput2( this->m_Image2 );
-
-		// define pattern type
-		CheckerboardFilterType::PatternArrayType pattern;
-		pattern[0] = 4;
-		pattern[1] = 4;
-		pattern[2] = 4;
-		checker->SetCheckerPattern( pattern );
-
-		std::cout << "Checkerboard image created." << std::endl;
 		return;
 	}
 
 	template< typename TPixelType >
 	void ValidationFilter< TPixelType >::FiducialAlignment()
 	{
-		std::cout << "Fiducial alignment complete." << std::endl;
+		*this->m_OutputStream << "Fiducial alignment complete." << std::endl;
 		return;
 	}
 } // end namespace
@@ -46,6 +46,7 @@
 
 // applying transform
 #include "itkResampleImageFilter.h"
+#include "itkLinearTransformResampleImageFilter.h"
 
 // additional C++ libraries
 #include <itksys/SystemTools.hxx>
@@ -943,17 +944,15 @@ int main(int argc, char * argv[])
 	// ********************** APPLY TRANSFORM ***************************
 	if( inputs->WriteImage() || inputs->PerformOverlapMeasures() )
 	{
-		// resample image
-		typedef itk::ResampleImageFilter< FloatImageType, FloatImageType >	ResampleFilterType;
+		// resample image (rows are stepped incrementally since the rigid transform is linear)
+		typedef itk::LinearTransformResampleImageFilter< FloatImageType >	ResampleFilterType;
 		ResampleFilterType::Pointer resampler = ResampleFilterType::New();
 		// initialize with fixed image parameters
-		resampler->SetSize( fixedImage->GetLargestPossibleRegion().GetSize() );
-		resampler->SetOutputOrigin( fixedImage->GetOrigin() );
-		resampler->SetOutputSpacing( fixedImage->GetSpacing() );
-		resampler->SetOutputDirection( fixedImage->GetDirection() );
+		resampler->SetReferenceImage( fixedImage );
 		resampler->SetDefaultPixelValue( inputs->DefaultPixelValue() );
 		resampler->SetInput( movingImage );
 		resampler->SetTransform( finalRigidTransform );
+		resampler->Update();
 
 		// write out image
 		if( inputs->WriteImage() )
@@ -14,8 +14,7 @@ Goals:
 #include "itkImage.h"
 #include "itkImageFileReader.h"
 #include "itkLabelOverlapMeasuresImageFilter.h"
-#include "itkBinaryThresholdImageFilter.h"
-#include "itkHausdorffDistanceImageFilter.h"
+#include "itkBoundingBoxHausdorffDistanceFilter.h"
 #include <iomanip>
 
 // write function to perform the overlap measures
@@ -55,6 +54,13 @@ int LabelOverlapMeasures( typename ImageType::Pointer source, typename ImageType
 	file << " ** Individual Labels ** " << std::endl;
 	file << "Label,Target,Union (jaccard),Mean (dice),Volume sim.,False negative,False positive,Hausdorff distance,Average distance\n";
 
+	// calculate Hausdorff distances for all labels (same values as HausdorffDistanceImageFilter, computed within each label's bounding box)
+	typedef itk::BoundingBoxHausdorffDistanceFilter< ImageType >	DistanceType;
+	typename DistanceType::Pointer distance = DistanceType::New();
+	distance->SetInput1( source );
+	distance->SetInput2( target );
+	distance->Update();
+
 	// for each individual labels
 	FilterType::MapType labelMap = filter->GetLabelSetMeasures();
 	FilterType::MapType::const_iterator it;
@@ -78,35 +84,9 @@ int LabelOverlapMeasures( typename ImageType::Pointer source, typename ImageType
 		file << "," << filter->GetFalseNegativeError( label );
 		file << "," << filter->GetFalsePositiveError( label );
 
-		// isolate label in source image
-		typedef itk::BinaryThresholdImageFilter< ImageType, ImageType > ThresholdType;
-		typename ThresholdType::Pointer disSource = ThresholdType::New();
-		disSource->SetInput( filter->GetSourceImage() );
-		disSource->SetLowerThreshold( label );
-		disSource->SetUpperThreshold( label );
-		disSource->SetInsideValue( static_cast< ImageType::PixelType >( 1 ) );
-		disSource->SetOutsideValue( static_cast< ImageType::PixelType >( 0 ) );
-		disSource->Update();
-
-		// isolate label in target image
-		typename ThresholdType::Pointer disTarget = ThresholdType::New();
-		disTarget->SetInput( filter->GetTargetImage() );
-		disTarget->SetLowerThreshold( label );
-		disTarget->SetUpperThreshold( label );
-		disTarget->SetInsideValue( static_cast< ImageType::PixelType >( 1 ) );
-		disTarget->SetOutsideValue( static_cast< ImageType::PixelType >( 0 ) );
-		disTarget->Update();
-
-		// calculate Hausdorff distance
-		typedef itk::HausdorffDistanceImageFilter< ImageType, ImageType >	DistanceType;
-		typename DistanceType::Pointer distance = DistanceType::New();
-		distance->SetInput1( disSource->GetOutput() );
-		distance->SetInput2( disTarget->GetOutput() );
-		distance->Update();
-		//distance->Print( std::cout );
-
-		file << "," << distance->GetHausdorffDistance();
-		file << "," << distance->GetAverageHausdorffDistance();
+		// Hausdorff distances of the label (-1 if it is missing from one label map)
+		file << "," << distance->GetHausdorffDistance( label );
+		file << "," << distance->GetAverageHausdorffDistance( label );
 		file << std::endl;
     }
 
@@ -0,0 +1,128 @@
+/*
+ * The goal of this code is to read the transform history written by the
+ * registration with debugTransforms on (Level<n>TransformHistory.bin) and
+ * either print it as a table or write .tfm files for chosen iterations.
+ *
+ * Call function:
+ * extractTransformHistory.exe historyFile list
+ * extractTransformHistory.exe historyFile outputPrefix steps
+ * extractTransformHistory.exe historyFile outputPrefix all
+ * extractTransformHistory.exe historyFile outputPrefix iteration1 [iteration2 ...]
+ *
+ * 'steps' writes the iterations at which the step length changed (the files
+ * the registration used to write). Files are named <outputPrefix>Transform_<iteration>.tfm.
+ *
+ */
+
+// reading and writing files
+#include "ReadWriteFunctions.hxx"
+#include "itkTransformHistoryLog.h"
+
+#include "itkScaleVersor3DTransform.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <set>
+#include <string>
+
+typedef itk::ScaleVersor3DTransform< double >	TransformType;
+
+int main( int argc, char * argv[] )
+{
+	if( argc < 3 )
+	{
+		std::cerr << "Usage: " << argv[0] << " historyFile list" << std::endl;
+		std::cerr << "       " << argv[0] << " historyFile outputPrefix steps|all|iteration1 [iteration2 ...]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// read in the history
+	itk::TransformHistoryLog::ParametersType fixedParameters;
+	std::vector< itk::TransformHistoryLog::RecordType > records;
+	try
+	{
+		itk::TransformHistoryLog::Read( argv[1], fixedParameters, records );
+	}
+	catch (itk::ExceptionObject & err)
+	{
+		std::cerr << "Exception Object Caught!" << std::endl;
+		std::cerr << err << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// print the table
+	if( std::string( argv[2] ) == "list" )
+	{
+		std::cout << "iteration, step length, metric value, parameters" << std::endl;
+		for( unsigned int i = 0; i < records.size(); ++i )
+		{
+			std::cout << records[i].iteration << ", " << records[i].stepLength << ", " << records[i].value;
+			for( unsigned int j = 0; j < records[i].parameters.size(); ++j )
+			{
+				std::cout << ", " << records[i].parameters[j];
+			}
+			std::cout << std::endl;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	if( argc < 4 )
+	{
+		std::cerr << "Specify steps, all or a list of iterations." << std::endl;
+		return EXIT_FAILURE;
+	}
+	const std::string mode = argv[3];
+	std::set< int > iterations;
+	for( int i = 3; i < argc && mode != "steps" && mode != "all"; ++i )
+	{
+		iterations.insert( atoi( argv[i] ) );
+	}
+
+	// write out the chosen transforms
+	TransformType::Pointer transform = TransformType::New();
+	if( records.size() > 0 && records[0].parameters.size() != transform->GetNumberOfParameters() )
+	{
+		std::cerr << "History holds " << records[0].parameters.size() << " parameters, expected " << transform->GetNumberOfParameters() << std::endl;
+		return EXIT_FAILURE;
+	}
+	if( fixedParameters.Size() == transform->GetFixedParameters().Size() )
+	{
+		TransformType::ParametersType fixed( fixedParameters.Size() );
+		for( unsigned int j = 0; j < fixed.Size(); ++j )
+		{
+			fixed[j] = fixedParameters[j];
+		}
+		transform->SetFixedParameters( fixed );
+	}
+
+	double stepLength = 0;
+	int written = 0;
+	for( unsigned int i = 0; i < records.size(); ++i )
+	{
+		bool write = mode == "all" || iterations.count( records[i].iteration ) > 0;
+		if( mode == "steps" )
+		{
+			write = std::abs( records[i].stepLength - stepLength ) > 0.0001;
+			stepLength = records[i].stepLength;
+		}
+		if( !write )
+		{
+			continue;
+		}
+
+		TransformType::ParametersType parameters( transform->GetNumberOfParameters() );
+		for( unsigned int j = 0; j < parameters.Size(); ++j )
+		{
+			parameters[j] = records[i].parameters[j];
+		}
+		transform->SetParameters( parameters );
+
+		std::string filename = std::string( argv[2] ) + "Transform_" + std::to_string( records[i].iteration ) + ".tfm";
+		WriteOutTransform< TransformType >( filename.c_str(), transform );
+		++written;
+	}
+
+	std::cout << written << " of " << records.size() << " transforms written." << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+/*
+ * The goal of this code is to compare the discrete and recursive gaussian
+ * smoothing used by SmoothImage (PreprocessingFunctions.hxx) on a CT volume.
+ * Each sigma is run with both filters and the wall time of each (best of
+ * the repetitions) and the RMS difference between the two outputs are
+ * printed as a table. The discrete filter is run with a kernel wide enough
+ * for the sigma; the last column tells whether the default maximum kernel
+ * width (32, used by the registration) truncates the kernel at that sigma.
+ *
+ * Call function:
+ * smoothingBenchmark.exe inputImage repetitions sigma1 [sigma2 ...]
+ *
+ */
+
+// reading files and smoothing
+#include "ReadWriteFunctions.hxx"
+#include "PreprocessingFunctions.hxx"
+
+#include "itkImage.h"
+#include "itkTimeProbe.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkGaussianOperator.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+typedef itk::Image< short, 3 >	ImageType;
+
+// maximum kernel width of the discrete filter in the benchmark (large enough not to truncate)
+const unsigned int BenchmarkKernelWidth = 1024;
+
+// widest kernel the discrete filter needs for the sigma (same settings as DiscreteGaussianImageFilter)
+unsigned int DiscreteKernelWidth( ImageType::Pointer image, float sigma )
+{
+	unsigned int width = 0;
+	for( unsigned int d = 0; d < 3; ++d )
+	{
+		itk::GaussianOperator< double, 3 > oper;
+		oper.SetDirection( d );
+		oper.SetVariance( sigma/( image->GetSpacing()[d]*image->GetSpacing()[d] ) );
+		oper.SetMaximumError( 0.01 );
+		oper.SetMaximumKernelWidth( BenchmarkKernelWidth );
+		oper.CreateDirectional();
+		width = std::max( width, static_cast< unsigned int >( oper.GetSize()[d] ) );
+	}
+
+	return width;
+}
+
+// run one smoothing method and return the best wall time in seconds
+double TimeSmoothing( ImageType::Pointer image, float sigma, bool recursive, int repetitions, ImageType::Pointer & output )
+{
+	double best = -1.0;
+	for( int i = 0; i < repetitions; ++i )
+	{
+		itk::TimeProbe clock;
+		clock.Start();
+		output = SmoothImage< ImageType >( image, sigma, recursive, BenchmarkKernelWidth );
+		clock.Stop();
+
+		if( best < 0 || clock.GetTotal() < best )
+		{
+			best = clock.GetTotal();
+		}
+	}
+
+	return best;
+}
+
+// root mean square difference between two images occupying the same region
+double RMSDifference( ImageType::Pointer image1, ImageType::Pointer image2 )
+{
+	itk::ImageRegionConstIterator< ImageType > it1( image1, image1->GetBufferedRegion() );
+	itk::ImageRegionConstIterator< ImageType > it2( image2, image2->GetBufferedRegion() );
+	double sum = 0.0;
+	double count = 0.0;
+	for( it1.GoToBegin(), it2.GoToBegin(); !it1.IsAtEnd(); ++it1, ++it2 )
+	{
+		const double difference = static_cast< double >( it1.Get() ) - static_cast< double >( it2.Get() );
+		sum += difference*difference;
+		++count;
+	}
+
+	return count > 0 ? std::sqrt( sum/count ) : 0.0;
+}
+
+int main( int argc, char * argv[] )
+{
+	if( argc < 4 )
+	{
+		std::cerr << "Usage: " << argv[0] << " inputImage repetitions sigma1 [sigma2 ...]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	ImageType::Pointer image = ReadInImage< ImageType >( argv[1] );
+	const int repetitions = std::max( 1, atoi( argv[2] ) );
+
+	std::cout << "Image size: " << image->GetLargestPossibleRegion().GetSize() << std::endl;
+	std::cout << "Image spacing: " << image->GetSpacing() << std::endl;
+
+	// time both methods for each sigma
+	std::cout << "\nsigma, discrete (s), recursive (s), speedup, RMS difference, kernel width, truncated at 32" << std::endl;
+	for( int i = 3; i < argc; ++i )
+	{
+		const float sigma = static_cast< float >( atof( argv[i] ) );
+
+		ImageType::Pointer discrete;
+		ImageType::Pointer recursive;
+		const double discreteTime = TimeSmoothing( image, sigma, false, repetitions, discrete );
+		const double recursiveTime = TimeSmoothing( image, sigma, true, repetitions, recursive );
+
+		std::cout << sigma << ", " << discreteTime << ", " << recursiveTime << ", "
+			<< ( recursiveTime > 0 ? discreteTime/recursiveTime : 0.0 ) << ", "
+			<< RMSDifference( discrete, recursive ) << ", ";
+		const unsigned int width = DiscreteKernelWidth( image, sigma );
+		std::cout << width << ", " << ( width > 32 ? "yes" : "no" ) << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}